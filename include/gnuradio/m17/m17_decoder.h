@@ -32,6 +32,17 @@ namespace gr
 	ENCR_AES,
 	ENCR_RES		//reserved
       } encr_t;
+      typedef enum
+      {
+	INPUT_FLOAT,		//symbols, see sps
+	INPUT_COMPLEX		//FM baseband at sps samples per symbol
+      } input_t;
+      typedef enum
+      {
+	OUTPUT_STREAM,		//16-byte payloads, zeros for erased frames
+	OUTPUT_TAGGED,		//the same, with packet_len and frame metadata tags
+	OUTPUT_PDU		//one PDU per payload on the pdu message port
+      } output_t;
 
       /*!
        * \brief Return a shared_ptr to a new instance of m17::m17_decoder.
@@ -43,14 +54,31 @@ namespace gr
        */
       static sptr make (bool debug_data, bool debug_ctrl, float sw_threshold,
 			float vt_threshold, bool callsign, bool signed_str, int encr_type,
-			std::string key, std::string seed);
+			std::string key, std::string seed,
+			int input_type = INPUT_FLOAT, int sps = 1);
       virtual void set_debug_data (bool debug) = 0;
       virtual void set_debug_ctrl (bool debug) = 0;
       virtual void set_callsign (bool callsign) = 0;
       virtual void set_sw_threshold (float sw_threshold) = 0;
       virtual void set_vt_threshold (float vt_threshold) = 0;
       virtual void set_signed (bool signed_str) = 0;
+      virtual void set_flywheel (int max_misses) = 0;
+      virtual void set_false_alarm_rate (float pfa) = 0;
+      virtual float sw_threshold () = 0;
+      virtual float false_sync_rate () = 0;
+      virtual void set_squelch (float hang_time) = 0;
+      virtual bool squelch_open () = 0;
+      virtual void set_normalize (bool normalize) = 0;
+      virtual void set_soft_bits (int bits) = 0;
+      virtual uint64_t rejects_lich () = 0;
+      virtual uint64_t rejects_viterbi () = 0;
+      virtual uint64_t rejects_fn () = 0;
       virtual void set_key (std::string key) = 0;
+      virtual void set_pub_keys (std::string keys) = 0;
+      virtual void set_keyring (std::string keys) = 0;
+      virtual void set_filter (std::string rules) = 0;
+      virtual uint64_t frames_filtered () = 0;
+      virtual void set_output_mode (int mode) = 0;
       virtual void set_seed (std::string seed) = 0;
       virtual void parse_raw_key_string (uint8_t * dest, const char *inp) = 0;
       virtual void scrambler_sequence_generator () = 0;
@@ -0,0 +1,176 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "aes_engine.h"
+#include "aes.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_X86
+#include <immintrin.h>
+#endif
+
+namespace gr
+{
+	namespace m17
+	{
+
+		static const uint8_t SBOX[256] =
+		{
+			0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+			0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+			0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+			0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+			0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+			0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+			0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+			0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+			0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+			0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+			0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+			0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+			0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+			0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+			0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+			0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+		};
+
+		aes_engine::aes_engine() : _impl(AES_TINIER), _keyed(false), _key(), _subtype(-1), _rounds(0)
+		{
+		}
+
+		aes_engine::impl_t aes_engine::impl()
+		{
+			return _impl;
+		}
+
+		const char *aes_engine::impl_name()
+		{
+			switch (_impl)
+			{
+			case AES_NI:
+				return "AES-NI";
+			default:
+				return "tinier-aes";
+			}
+		}
+
+		void aes_engine::set_key(const uint8_t key[32], int8_t subtype)
+		{
+			if (_keyed && subtype == _subtype && memcmp(key, _key, sizeof(_key)) == 0)
+				return;
+
+			memcpy(_key, key, sizeof(_key));
+			_subtype = subtype;
+			_keyed = true;
+			_impl = AES_TINIER;
+
+#ifdef AES_X86
+			if (!__builtin_cpu_supports("aes") || !__builtin_cpu_supports("sse2") || !expand_key())
+				return;
+
+			// the counter block layout of the stream mode, any values do
+			uint8_t iv[16], ref[16] = {0}, out[16] = {0};
+			for (uint8_t i = 0; i < 16; i++)
+				iv[i] = 0xA5 ^ (17 * i);
+
+			tinier_crypt(iv, ref);
+			ni_crypt(iv, out);
+			if (memcmp(ref, out, sizeof(ref)) == 0)
+				_impl = AES_NI;
+#endif
+		}
+
+		void aes_engine::ctr_crypt(const uint8_t iv[16], uint8_t payload[16])
+		{
+#ifdef AES_X86
+			if (_impl == AES_NI)
+			{
+				ni_crypt(iv, payload);
+				return;
+			}
+#endif
+			tinier_crypt(iv, payload);
+		}
+
+		// FIPS-197 key expansion for the subtype, round keys in byte order
+		bool aes_engine::expand_key()
+		{
+			if (_subtype < 0 || _subtype > 2)
+				return false;
+
+			const int nk = 4 + 2 * _subtype; // key length in 32-bit words
+			_rounds = nk + 6;
+
+			uint8_t *w = _round_keys;
+			memcpy(w, _key, 4 * nk);
+
+			uint8_t rcon = 0x01;
+			for (int i = nk; i < 4 * (_rounds + 1); i++)
+			{
+				uint8_t t[4];
+				memcpy(t, &w[4 * (i - 1)], 4);
+
+				if (i % nk == 0)
+				{
+					uint8_t t0 = t[0];
+					t[0] = SBOX[t[1]] ^ rcon;
+					t[1] = SBOX[t[2]];
+					t[2] = SBOX[t[3]];
+					t[3] = SBOX[t0];
+					rcon = (rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0x00);
+				}
+				else if (nk > 6 && i % nk == 4)
+				{
+					for (uint8_t k = 0; k < 4; k++)
+						t[k] = SBOX[t[k]];
+				}
+
+				for (uint8_t k = 0; k < 4; k++)
+					w[4 * i + k] = w[4 * (i - nk) + k] ^ t[k];
+			}
+
+			return true;
+		}
+
+		// tinier-aes takes non-const pointers and may update the counter block
+		void aes_engine::tinier_crypt(const uint8_t iv[16], uint8_t payload[16])
+		{
+			uint8_t ctr[16], key[32];
+
+			memcpy(ctr, iv, sizeof(ctr));
+			memcpy(key, _key, sizeof(key));
+			aes_ctr_bytewise_payload_crypt(ctr, key, payload, _subtype);
+		}
+
+#ifdef AES_X86
+		__attribute__((target("aes,sse2"))) void aes_engine::ni_crypt(const uint8_t iv[16], uint8_t payload[16])
+		{
+			const __m128i *rk = (const __m128i *)_round_keys;
+
+			__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)iv), _mm_load_si128(&rk[0]));
+			for (int r = 1; r < _rounds; r++)
+				s = _mm_aesenc_si128(s, _mm_load_si128(&rk[r]));
+			s = _mm_aesenclast_si128(s, _mm_load_si128(&rk[_rounds]));
+
+			s = _mm_xor_si128(s, _mm_loadu_si128((const __m128i *)payload));
+			_mm_storeu_si128((__m128i *)payload, s);
+		}
+#else
+		void aes_engine::ni_crypt(const uint8_t iv[16], uint8_t payload[16])
+		{
+			tinier_crypt(iv, payload);
+		}
+#endif
+
+	} /* namespace m17 */
+} /* namespace gr */
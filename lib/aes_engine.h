@@ -0,0 +1,64 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_AES_ENGINE_H
+#define INCLUDED_M17_AES_ENGINE_H
+
+#include <stdint.h>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * AES-CTR payload encryption with a key schedule expanded once per key (or
+ * AES subtype) change instead of once per frame. The 16-byte keystream
+ * block is computed with the AES-NI instructions when the CPU has them.
+ * Every new key is checked on a test counter block against tinier-aes'
+ * aes_ctr_bytewise_payload_crypt(); if they disagree, or without AES-NI,
+ * each frame goes through tinier-aes as before.
+ */
+    class aes_engine
+    {
+    public:
+      typedef enum
+      {
+	AES_TINIER,		//tinier-aes, one key expansion per call
+	AES_NI
+      } impl_t;
+
+        aes_engine ();
+
+      // subtype: 0 - AES128, 1 - AES192, 2 - AES256, as in the LSF TYPE field;
+      // no-op if neither the key nor the subtype changed
+      void set_key (const uint8_t key[32], int8_t subtype);
+      impl_t impl ();
+      const char *impl_name ();
+
+      // same result as aes_ctr_bytewise_payload_crypt (iv, key, payload, subtype)
+      void ctr_crypt (const uint8_t iv[16], uint8_t payload[16]);
+
+    private:
+#define AES_MAX_ROUNDS 14
+      impl_t _impl;
+      bool _keyed;
+      uint8_t _key[32];
+      int8_t _subtype;
+      int _rounds;
+      alignas (16) uint8_t _round_keys[(AES_MAX_ROUNDS + 1) * 16];
+
+      bool expand_key ();
+      void tinier_crypt (const uint8_t iv[16], uint8_t payload[16]);
+      void ni_crypt (const uint8_t iv[16], uint8_t payload[16]);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_AES_ENGINE_H */
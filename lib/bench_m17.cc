@@ -0,0 +1,137 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Throughput of the Viterbi and Golay decoders against libm17, and the
+ * decoded bit error rate of stream frames through gaussian noise.
+ * Usage: bench_m17 [frames]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "m17.h"
+#include "golay_decoder.h"
+#include "viterbi_decoder.h"
+
+using namespace gr::m17;
+
+// ns per call of f, averaged over n calls
+template <typename F>
+static double time_ns(int n, F f)
+{
+	auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+		f(i);
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+// deinterleaved, derandomized soft bits of a stream frame through noise
+static void stream_soft_bits(uint16_t out[2 * SYM_PER_PLD], const uint8_t data[16], float sigma, std::mt19937 &rng)
+{
+	std::normal_distribution<float> noise(0.0f, 1.0f);
+	float frame[SYM_PER_FRA];
+	uint16_t soft[2 * SYM_PER_PLD];
+	lsf_t lsf;
+
+	memset(&lsf, 0, sizeof(lsf));
+	gen_frame(frame, data, FRAME_STR, &lsf, 0, 0);
+	for (uint16_t i = SYM_PER_SWD; i < SYM_PER_FRA; i++)
+		frame[i] += sigma * noise(rng);
+	slice_symbols(soft, &frame[SYM_PER_SWD]);
+	randomize_soft_bits(soft);
+	reorder_soft_bits(out, soft);
+}
+
+int main(int argc, char **argv)
+{
+	const int frames = (argc > 1) ? atoi(argv[1]) : 20000;
+	std::mt19937 rng(1);
+	volatile uint32_t sink = 0;
+	uint16_t soft[2 * SYM_PER_PLD];
+	uint8_t soft8[2 * SYM_PER_PLD], data[16], out[19];
+
+	for (uint8_t i = 0; i < sizeof(data); i++)
+		data[i] = rng();
+	stream_soft_bits(soft, data, 0.7f, rng);
+	for (uint16_t i = 0; i < 2 * SYM_PER_PLD; i++)
+		soft8[i] = soft[i] >> 8;
+
+	// Viterbi, stream frame payload
+	printf("Viterbi, us per stream frame\n");
+	printf("  libm17        %6.2f\n", time_ns(frames, [&](int)
+										 { sink += viterbi_decode_punctured(out, &soft[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2)); }) / 1000);
+	for (int impl = viterbi_decoder::VITERBI_SCALAR; impl <= viterbi_decoder::VITERBI_AVX2; impl++)
+	{
+		viterbi_decoder v;
+		v.set_impl((viterbi_decoder::impl_t)impl);
+		if (v.impl() != impl)
+			continue;
+		printf("  %-6s 16-bit %6.2f\n", v.impl_name(), time_ns(frames, [&](int)
+															{ sink += v.decode_punctured(out, &soft[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2)); }) / 1000);
+		printf("  %-6s  8-bit %6.2f\n", v.impl_name(), time_ns(frames, [&](int)
+															{ sink += v.decode_punctured(out, &soft8[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2)); }) / 1000);
+	}
+
+	// Golay, LICH codewords; sigma relative to 0..0xFFFF
+	printf("Golay, ns per codeword: libm17, golay_decoder\n");
+	for (float sigma : {0.0f, 0.35f, 0.7f})
+	{
+		std::normal_distribution<float> noise(0.0f, 1.0f);
+		std::vector<uint16_t> cws(24 * frames);
+		uint32_t dist;
+
+		for (int t = 0; t < frames; t++)
+		{
+			uint32_t cw = golay24_encode(rng() & 0xFFF);
+			for (uint8_t j = 0; j < 24; j++)
+			{
+				float x = ((cw >> (23 - j)) & 1) + sigma * noise(rng);
+				cws[24 * t + j] = std::max(0L, std::min(0xFFFFL, lrintf(x * 0xFFFF)));
+			}
+		}
+
+		double ref = time_ns(frames, [&](int t)
+							 { sink += golay24_sdecode(&cws[24 * t]); });
+		double dec = time_ns(frames, [&](int t)
+							 { sink += golay_decoder::decode(&cws[24 * t], &dist) + dist; });
+		printf("  sigma %.2f  %6.0f %6.0f\n", sigma, ref, dec);
+	}
+
+	// decoded BER of stream frames, 8-bit: the same soft bits truncated
+	printf("Viterbi, decoded BER over %d stream frames, 16-bit and 8-bit\n", frames);
+	viterbi_decoder v;
+	for (float sigma = 0.5f; sigma < 0.95f; sigma += 0.1f)
+	{
+		long errors = 0, errors8 = 0;
+
+		for (int t = 0; t < frames; t++)
+		{
+			for (uint8_t i = 0; i < sizeof(data); i++)
+				data[i] = rng();
+			stream_soft_bits(soft, data, sigma, rng);
+			for (uint16_t i = 0; i < 2 * SYM_PER_PLD; i++)
+				soft8[i] = soft[i] >> 8;
+
+			v.decode_punctured(out, &soft[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2));
+			for (uint8_t i = 0; i < 16; i++)
+				errors += __builtin_popcount(out[3 + i] ^ data[i]);
+			v.decode_punctured(out, &soft8[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2));
+			for (uint8_t i = 0; i < 16; i++)
+				errors8 += __builtin_popcount(out[3 + i] ^ data[i]);
+		}
+		printf("  sigma %.1f  %.2e  %.2e\n", sigma, (double)errors / (128.0 * frames), (double)errors8 / (128.0 * frames));
+	}
+
+	return (sink == 0x5A5A5A5A); // keeps the timed calls
+}
@@ -0,0 +1,103 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "frame_encoder.h"
+#include "m17_tables.h"
+
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		static inline void set_bit(uint8_t *bits, int pos)
+		{
+			bits[pos / 8] |= 0x80 >> (pos % 8);
+		}
+
+		// encode len bytes plus the 4 flush bits, slot[] gives the position of each encoded bit
+		void frame_encoder::conv_encode(uint8_t rf[SYM_PER_PLD * 2 / 8], const uint8_t *in, int len, const int16_t *slot)
+		{
+			uint8_t state = 0;
+
+			for (int i = 0; i <= len; i++)
+			{
+				const uint8_t b = (i < len) ? in[i] : 0;
+				uint16_t o = CONV_TABLE.out[state][b];
+				state = b & 0xF;
+
+				if (i == len) // only the 4 flush bits
+					o &= 0xFF00;
+
+				// only the set bits are placed
+				for (; o; o &= o - 1)
+				{
+					int16_t pos = slot[16 * i + 15 - __builtin_ctz(o)];
+					if (pos >= 0)
+						set_bit(rf, pos);
+				}
+			}
+		}
+
+		void frame_encoder::gen_frame(float out[SYM_PER_FRA], const uint8_t *data, frame_t type, const lsf_t *lsf,
+									  uint8_t lich_cnt, uint16_t fn)
+		{
+			uint8_t rf[SYM_PER_PLD * 2 / 8]; // type-4 bits, packed
+			const int8_t *sync;
+
+			memset(rf, 0, sizeof(rf));
+
+			if (type == FRAME_LSF)
+			{
+				sync = lsf_sync_symbols;
+				conv_encode(rf, (const uint8_t *)lsf, sizeof(lsf_t), LSF_SLOTS.slot);
+			}
+			else if (type == FRAME_STR)
+			{
+				sync = str_sync_symbols;
+
+				// LICH: 40 LSF bits and the LICH counter, 4 Golay codewords
+				uint8_t lich[6];
+				memcpy(lich, (const uint8_t *)lsf + lich_cnt * 5, 5);
+				lich[5] = lich_cnt << 5;
+
+				for (uint8_t i = 0; i < 4; i++)
+				{
+					const uint8_t *l = &lich[3 * (i / 2)];
+					uint16_t d = (i % 2) ? ((l[1] & 0x0F) << 8) | l[2] : (l[0] << 4) | (l[1] >> 4);
+
+					for (uint32_t cw = golay_encode(d); cw; cw &= cw - 1)
+						set_bit(rf, INTRL_TABLE.seq[i * 24 + 23 - __builtin_ctz(cw)]);
+				}
+
+				uint8_t in[2 + 16];
+				in[0] = fn >> 8;
+				in[1] = fn & 0xFF;
+				memcpy(&in[2], data, 16);
+				conv_encode(rf, in, sizeof(in), STR_SLOTS.slot);
+			}
+			else
+			{
+				::gen_frame(out, data, type, lsf, lich_cnt, fn);
+				return;
+			}
+
+			for (uint8_t i = 0; i < SYM_PER_SWD; i++)
+				out[i] = sync[i];
+
+			// randomize and map 4 symbols at a time
+			for (uint8_t i = 0; i < sizeof(rf); i++)
+				memcpy(&out[SYM_PER_SWD + 4 * i], SYMBOL_TABLE.sym[rf[i] ^ RAND_SEQ[i]], 4 * sizeof(float));
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
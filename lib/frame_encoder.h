@@ -0,0 +1,43 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_FRAME_ENCODER_H
+#define INCLUDED_M17_FRAME_ENCODER_H
+
+#include <stdint.h>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Frame generator for the coder, same output as libm17's gen_frame().
+ * The frame bits are never unpacked: the LICH is Golay encoded a codeword
+ * at a time and the payload convolutionally encoded a byte at a time, each
+ * set bit is written straight to its punctured and interleaved position,
+ * and the randomizer and the symbol mapping work on whole bytes.
+ */
+    class frame_encoder
+    {
+    public:
+      // same arguments as libm17's gen_frame(), LSF and stream frames
+      static void gen_frame (float out[SYM_PER_FRA], const uint8_t * data,
+			     frame_t type, const lsf_t * lsf, uint8_t lich_cnt,
+			     uint16_t fn);
+
+    private:
+      static void conv_encode (uint8_t rf[SYM_PER_PLD * 2 / 8],
+			       const uint8_t * in, int len,
+			       const int16_t * slot);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_FRAME_ENCODER_H */
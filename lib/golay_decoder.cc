@@ -0,0 +1,204 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "golay_decoder.h"
+#include "m17_tables.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// libm17's soft XOR, (a*(1-b) + (1-a)*b) in 16-bit fixed point
+		static inline uint16_t soft_xor(uint16_t a, uint16_t b)
+		{
+			uint32_t r = (((uint32_t)a * (0xFFFF - b)) >> 16) + (((uint32_t)(0xFFFF - a) * b) >> 16);
+			return (r <= 0xFFFF) ? r : 0xFFFF;
+		}
+
+		// the same with a hard b
+		static inline uint16_t soft_xor(uint16_t a, bool b)
+		{
+			return b ? ((uint32_t)(0xFFFF - a) * 0xFFFF) >> 16 : ((uint32_t)a * 0xFFFF) >> 16;
+		}
+
+		static inline uint16_t hard(const uint16_t *in)
+		{
+			uint16_t h = 0;
+			for (uint8_t i = 0; i < 12; i++)
+				h |= (in[i] > 0x7FFF) << i;
+			return h;
+		}
+
+		// rows of the encoding and decoding matrices as soft bits, 0 or 0xFFFF
+		struct soft_rows_t
+		{
+			uint16_t enc[12][16];
+			uint16_t dec[12][16];
+
+			constexpr soft_rows_t() : enc(), dec()
+			{
+				for (uint8_t i = 0; i < 12; i++)
+					for (uint8_t k = 0; k < 12; k++)
+					{
+						enc[i][k] = ((GOLAY_ENCODE_MATRIX[i] >> k) & 1) ? 0xFFFF : 0x0000;
+						dec[i][k] = ((GOLAY_DECODE_MATRIX[i] >> k) & 1) ? 0xFFFF : 0x0000;
+					}
+			}
+		};
+		static constexpr soft_rows_t SOFT_ROWS{};
+
+		// soft sum of the matrix rows selected by sel, accumulated in the same order
+		// as libm17 since the rounding of each soft XOR matters; with a hard b,
+		// soft_xor(a, b) is (a ^ b) - 1 floored at 0, 16 lanes at a time and
+		// without branches on sel, whose bits are noise
+		static void soft_rows(uint16_t out[16], uint16_t sel, const uint16_t rows[12][16])
+		{
+			for (uint8_t k = 0; k < 16; k++)
+				out[k] = 0;
+
+			for (uint8_t i = 0; i < 12; i++)
+			{
+				const uint16_t keep = ((sel >> i) & 1) - 1; // 0xFFFF if the row is not selected
+				for (uint8_t k = 0; k < 16; k++)
+				{
+					uint16_t r = out[k] ^ rows[i][k];
+					r -= (r != 0);
+					out[k] = (out[k] & keep) | (r & ~keep);
+				}
+			}
+		}
+
+		// soft weights of s XORed with any hard 12-bit pattern h:
+		// weight(h) = w0 + tab[0][h & 15] + tab[1][(h >> 4) & 15] + tab[2][h >> 8]
+		typedef struct
+		{
+			uint32_t w0;
+			int32_t tab[3][16];
+		} weights_t;
+
+		static void soft_weights(weights_t *w, const uint16_t s[12])
+		{
+			int32_t delta[12];
+
+			w->w0 = 0;
+			for (uint8_t k = 0; k < 12; k++)
+			{
+				uint16_t x0 = soft_xor(s[k], false);
+				w->w0 += x0;
+				delta[k] = (int32_t)soft_xor(s[k], true) - x0;
+			}
+
+			for (uint8_t n = 0; n < 3; n++)
+			{
+				w->tab[n][0] = 0;
+				for (uint8_t m = 1; m < 16; m++)
+					w->tab[n][m] = w->tab[n][m & (m - 1)] + delta[4 * n + __builtin_ctz(m)];
+			}
+		}
+
+		static inline uint32_t weight(const weights_t *w, uint16_t h)
+		{
+			return w->w0 + w->tab[0][h & 15] + w->tab[1][(h >> 4) & 15] + w->tab[2][h >> 8];
+		}
+
+		// libm17's s_detect_errors() on the codeword in M17 bit order
+		uint32_t golay_decoder::detect_errors(const uint16_t codeword[24])
+		{
+			uint16_t data[12], parity[12], cksum[16], syndrome[12];
+			weights_t w;
+
+			for (uint8_t i = 0; i < 12; i++)
+			{
+				data[i] = codeword[11 - i];
+				parity[i] = codeword[23 - i];
+			}
+
+			soft_rows(cksum, hard(data), SOFT_ROWS.enc);
+
+			uint32_t sum = 0;
+			for (uint8_t k = 0; k < 12; k++)
+			{
+				syndrome[k] = soft_xor(parity[k], cksum[k]);
+				sum += syndrome[k];
+			}
+
+			const uint16_t s = hard(syndrome);
+
+			// all (less than 4) errors in the parity part
+			if (sum < 4 * 0xFFFE)
+				return s;
+
+			soft_weights(&w, syndrome);
+
+			// one of the errors in the data part, up to 3 in the parity part
+			for (uint8_t i = 0; i < 12; i++)
+				if (weight(&w, GOLAY_ENCODE_MATRIX[i]) < 3 * 0xFFFE)
+					return (1 << (i + 12)) | (s ^ GOLAY_ENCODE_MATRIX[i]);
+
+			// two of the errors in the data part, up to 2 in the parity part
+			for (uint8_t i = 0; i < 11; i++)
+				for (uint8_t j = i + 1; j < 12; j++)
+				{
+					uint16_t coded_error = GOLAY_ENCODE_MATRIX[i] ^ GOLAY_ENCODE_MATRIX[j];
+					if (weight(&w, coded_error) < 2 * 0xFFFF)
+						return (((1 << i) | (1 << j)) << 12) | (s ^ coded_error);
+				}
+
+			// all errors in the data part, through the inverse syndrome
+			uint16_t inv[16];
+			soft_rows(inv, s, SOFT_ROWS.dec);
+
+			sum = 0;
+			for (uint8_t k = 0; k < 12; k++)
+				sum += inv[k];
+
+			const uint16_t is = hard(inv);
+
+			if (sum < 4 * 0xFFFF)
+				return (uint32_t)is << 12;
+
+			soft_weights(&w, inv);
+
+			// one error in the parity part, up to 3 in the data part
+			for (uint8_t i = 0; i < 12; i++)
+				if (weight(&w, GOLAY_DECODE_MATRIX[i]) < 3 * (0xFFFF + 2))
+					return ((uint32_t)(is ^ GOLAY_DECODE_MATRIX[i]) << 12) | (1 << i);
+
+			return 0xFFFFFFFF;
+		}
+
+		uint16_t golay_decoder::decode(const uint16_t codeword[24], uint32_t *dist)
+		{
+			uint32_t errors = detect_errors(codeword);
+
+			if (errors == 0xFFFFFFFF)
+			{
+				*dist = 24 * 0xFFFF;
+				return 0xFFFF;
+			}
+
+			uint32_t rx = 0;
+			for (uint8_t j = 0; j < 24; j++)
+				rx |= (uint32_t)(codeword[j] > 0x7FFF) << (23 - j);
+
+			uint16_t data = ((rx ^ errors) >> 12) & 0x0FFF;
+
+			uint32_t cw = golay_encode(data);
+			*dist = 0;
+			for (uint8_t j = 0; j < 24; j++)
+				*dist += ((cw >> (23 - j)) & 1) ? 0xFFFF - codeword[j] : codeword[j];
+
+			return data;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
@@ -0,0 +1,43 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_GOLAY_DECODER_H
+#define INCLUDED_M17_GOLAY_DECODER_H
+
+#include <stdint.h>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Soft-decision Golay(24,12) decoder for the LICH chunks.
+ * Bit-exact with libm17's golay24_sdecode(): same search order and the same
+ * 16-bit soft arithmetic, including its rounding. XORing the soft syndrome
+ * with a hard error pattern changes each of its 12 terms by one of two
+ * values, so the weight of every candidate pattern is the syndrome weight
+ * plus 3 lookups in nibble tables built once per codeword, instead of 12
+ * soft XORs. Most codewords stop at the first test, the syndrome weight.
+ */
+    class golay_decoder
+    {
+    public:
+      // same return value as libm17's golay24_sdecode(), 0xFFFF if not decodable;
+      // dist: soft distance between the input and the decoded codeword,
+      // 0xFFFF per wrong bit, 24*0xFFFF if not decodable
+      static uint16_t decode (const uint16_t codeword[24], uint32_t * dist);
+
+    private:
+      static uint32_t detect_errors (const uint16_t codeword[24]);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_GOLAY_DECODER_H */
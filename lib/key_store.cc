@@ -0,0 +1,131 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "key_store.h"
+#include "uECC.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		uint64_t key_store::callsign_id(const uint8_t src[6])
+		{
+			uint64_t id = 0;
+			for (uint8_t i = 0; i < 6; i++)
+				id = (id << 8) | src[i];
+			return id;
+		}
+
+		static int hex_digit(char c)
+		{
+			if (c >= '0' && c <= '9')
+				return c - '0';
+			if (c >= 'a' && c <= 'f')
+				return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F')
+				return c - 'A' + 10;
+			return -1;
+		}
+
+		bool key_store::parse_key(uint8_t key[64], const std::string &hex)
+		{
+			uint8_t raw[65];
+			size_t len = hex.size() / 2;
+
+			if ((hex.size() % 2) || (len != 33 && len != 64 && len != 65))
+				return false;
+
+			for (size_t i = 0; i < len; i++)
+			{
+				int hi = hex_digit(hex[2 * i]), lo = hex_digit(hex[2 * i + 1]);
+				if (hi < 0 || lo < 0)
+					return false;
+				raw[i] = hi * 0x10 + lo;
+			}
+
+			const struct uECC_Curve_t *curve = uECC_secp256r1();
+
+			if (len == 33) // compressed
+			{
+				if (raw[0] != 0x02 && raw[0] != 0x03)
+					return false;
+				uECC_decompress(raw, key, curve);
+			}
+			else if (len == 65) // uncompressed, SEC1 prefix
+			{
+				if (raw[0] != 0x04)
+					return false;
+				memcpy(key, raw + 1, 64);
+			}
+			else
+				memcpy(key, raw, 64);
+
+			return uECC_valid_public_key(key, curve);
+		}
+
+		int key_store::load(const std::string &keys)
+		{
+			std::unordered_map<uint64_t, std::array<uint8_t, 64>> loaded;
+			const char *sep = ",; \t\r\n";
+			size_t pos = 0;
+
+			while ((pos = keys.find_first_not_of(sep, pos)) != std::string::npos)
+			{
+				size_t end = keys.find_first_of(sep, pos);
+				std::string entry = keys.substr(pos, end - pos);
+				pos = end;
+
+				size_t eq = entry.find('=');
+				std::string call = entry.substr(0, eq);
+				for (auto &c : call)
+					c = toupper(c); // the M17 charset has no lower case
+				uint8_t src[6];
+				std::array<uint8_t, 64> key;
+
+				if (eq == std::string::npos || call.empty() || call.size() > 9 ||
+					encode_callsign_bytes(src, (const uint8_t *)call.c_str()) != 0 ||
+					!parse_key(key.data(), entry.substr(eq + 1)))
+				{
+					printf("Public key ignored: %s\n", entry.c_str());
+					continue;
+				}
+
+				loaded[callsign_id(src)] = key;
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_keys.swap(loaded);
+			return _keys.size();
+		}
+
+		bool key_store::find(const uint8_t src[6], uint8_t key[64])
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto k = _keys.find(callsign_id(src));
+			if (k == _keys.end())
+				return false;
+			memcpy(key, k->second.data(), 64);
+			return true;
+		}
+
+		size_t key_store::size()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _keys.size();
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
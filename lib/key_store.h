@@ -0,0 +1,53 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_KEY_STORE_H
+#define INCLUDED_M17_KEY_STORE_H
+
+#include <stdint.h>
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Public keys of the stations whose stream signatures are checked, looked
+ * up by the encoded source callsign of the LSF. Keys are given as hex
+ * strings, 64 bytes raw (X,Y), 65 bytes with the 04 prefix or 33 bytes
+ * compressed (02/03 prefix); they are decompressed and validated once,
+ * when loaded, so a lookup is a hash map access and a copy. Nothing is
+ * precomputed per key: uECC_verify() still runs its full double-and-add
+ * from the affine key on every check.
+ * Safe to reload from another thread while the decoder looks keys up.
+ */
+    class key_store
+    {
+    public:
+      // entries "CALLSIGN=hexkey" separated by commas, semicolons or
+      // whitespace; replaces the current keys, returns the number loaded
+      int load (const std::string & keys);
+      bool find (const uint8_t src[6], uint8_t key[64]);	//src: encoded callsign
+      size_t size ();
+
+    private:
+      std::unordered_map < uint64_t, std::array < uint8_t, 64 >> _keys;
+      std::mutex _mutex;
+
+      static uint64_t callsign_id (const uint8_t src[6]);
+      static bool parse_key (uint8_t key[64], const std::string & hex);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_KEY_STORE_H */
@@ -0,0 +1,279 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "keyring.h"
+#include "scrambler.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		static bool parse_hex(uint8_t *out, size_t max_len, size_t *len, const std::string &hex)
+		{
+			if (hex.empty() || (hex.size() % 2) || hex.size() / 2 > max_len)
+				return false;
+
+			for (size_t i = 0; i < hex.size(); i++)
+				if (!isxdigit((unsigned char)hex[i]))
+					return false;
+
+			*len = hex.size() / 2;
+			for (size_t i = 0; i < *len; i++)
+				out[i] = strtoul(hex.substr(2 * i, 2).c_str(), NULL, 16);
+			return true;
+		}
+
+		int keyring::load(const std::string &keys)
+		{
+			std::vector<entry_t> loaded;
+			const char *sep = ",; \t\r\n";
+			size_t pos = 0;
+
+			while ((pos = keys.find_first_not_of(sep, pos)) != std::string::npos)
+			{
+				size_t end = keys.find_first_of(sep, pos);
+				std::string item = keys.substr(pos, end - pos);
+				pos = end;
+
+				size_t eq = item.find('=');
+				std::string sel = item.substr(0, eq);
+				std::string val = (eq == std::string::npos) ? "" : item.substr(eq + 1);
+				entry_t e = {};
+				bool ok = (eq != std::string::npos);
+
+				// selector
+				e.can = -1;
+				e.any_dst = true;
+				if (ok && sel.compare(0, 4, "can:") == 0)
+				{
+					char *num_end;
+					long can = strtol(sel.c_str() + 4, &num_end, 10);
+					ok = (num_end != sel.c_str() + 4) && (*num_end == '/' || *num_end == '\0') && (can >= 0) && (can <= 15);
+					e.can = can;
+					sel = (*num_end == '/') ? std::string(num_end + 1) : std::string("*");
+				}
+				if (ok && sel != "*")
+				{
+					for (auto &c : sel)
+						c = toupper(c); // the M17 charset has no lower case
+					ok = !sel.empty() && sel.size() <= 9 && encode_callsign_bytes(e.dst, (const uint8_t *)sel.c_str()) == 0;
+					e.any_dst = false;
+				}
+
+				// key
+				size_t len;
+				if (ok && val.compare(0, 4, "aes:") == 0)
+				{
+					e.encr = 2;
+					ok = parse_hex(e.key, sizeof(e.key), &len, val.substr(4));
+				}
+				else if (ok && val.compare(0, 4, "scr:") == 0)
+				{
+					uint8_t seed[3];
+					e.encr = 1;
+					ok = parse_hex(seed, sizeof(seed), &len, val.substr(4));
+					for (size_t i = 0; ok && i < len; i++)
+						e.seed = (e.seed << 8) | seed[i];
+				}
+				else
+					ok = false;
+
+				if (!ok)
+				{
+					printf("Keyring entry ignored: %s\n", item.c_str());
+					continue;
+				}
+
+				loaded.push_back(e);
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_entries.swap(loaded);
+			_cand.clear(); // indices into the old entries
+			_started = false;
+			return _entries.size();
+		}
+
+		int keyring::start(const lsf_t *lsf)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			const uint16_t type = ((uint16_t)lsf->type[0] << 8) + lsf->type[1];
+
+			// the LSF the trial runs on, sent again: the trial goes on
+			if (_started && type == _type && memcmp(_dst, lsf->dst, sizeof(_dst)) == 0 &&
+				memcmp(_meta, lsf->meta, sizeof(_meta)) == 0)
+				return _cand.size();
+
+			_type = type;
+			memcpy(_dst, lsf->dst, sizeof(_dst));
+			memcpy(_meta, lsf->meta, sizeof(_meta));
+			_cand.clear();
+			_started = true;
+
+			const uint8_t encr = (_type >> 3) & 3;
+			const uint8_t subtype = (_type >> 5) & 3;
+			const int8_t can = (_type >> 7) & 0xF;
+
+			if ((encr != 1 && encr != 2) || subtype > 2)
+				return 0;
+
+			for (size_t i = 0; i < _entries.size(); i++)
+			{
+				const entry_t &e = _entries[i];
+				if (e.encr == encr && (e.can < 0 || e.can == can) &&
+					(e.any_dst || memcmp(e.dst, lsf->dst, sizeof(e.dst)) == 0))
+					_cand.push_back({(int)i, 0, false, 0, 0});
+			}
+
+			_best = 0;
+			_frames = (_cand.size() == 1) ? KEYRING_TRIAL_FRAMES : 0; // nothing to try
+			return _cand.size();
+		}
+
+		void keyring::crypt(entry_t &e, uint8_t payload[16], uint16_t fn)
+		{
+			const int8_t subtype = (_type >> 5) & 3;
+
+			if (e.encr == 2)
+			{
+				uint8_t iv[16];
+				memcpy(iv, _meta, 14);
+				iv[14] = (fn >> 8) & 0x7F;
+				iv[15] = fn & 0xFF;
+
+				e.aes.set_key(e.key, subtype); // expanded once per stream subtype
+				e.aes.ctr_crypt(iv, payload);
+			}
+			else
+			{
+				uint8_t ks[16];
+				uint32_t seed = scrambler::jump(subtype, e.seed, fn & 0x7FFF);
+
+				scrambler::keystream(subtype, &seed, ks);
+				for (uint8_t i = 0; i < 16; i++)
+					payload[i] ^= ks[i];
+			}
+		}
+
+		static inline uint16_t get_bits(const uint8_t *in, int pos, int len)
+		{
+			uint16_t v = 0;
+			for (int i = pos; i < pos + len; i++)
+				v = (v << 1) | ((in[i / 8] >> (7 - (i % 8))) & 1);
+			return v;
+		}
+
+		int keyring::codec2_params(uint16_t type, const uint8_t payload[16], uint16_t wo[2], uint16_t e[2])
+		{
+			int pos[2], n = 0;
+
+			switch ((type >> 1) & 3)
+			{
+			case 2: // 3200 bps voice: 2 frames of V1 V2 Wo(7) E(5) LSP(50)
+				pos[n++] = 2;
+				pos[n++] = 64 + 2;
+				break;
+			case 3: // 1600 bps voice and data: V1 V2 Wo1(7) E1(5) V3 V4 Wo2(7) E2(5) LSP(36)
+				pos[n++] = 2;
+				pos[n++] = 16;
+				break;
+			default:
+				return 0;
+			}
+
+			for (int i = 0; i < n; i++)
+			{
+				wo[i] = get_bits(payload, pos[i], 7);
+				e[i] = get_bits(payload, pos[i] + 7, 5);
+			}
+			return n;
+		}
+
+		// pitch (Wo) and energy of speech change little from one codec2 frame
+		// to the next, random bits change them by a third of their range
+		uint32_t keyring::score(candidate_t &c, const uint8_t payload[16])
+		{
+			uint16_t wo[2], e[2];
+			const int n = codec2_params(_type, payload, wo, e);
+
+			if (n == 0) // data: plain text is rarely balanced like a keystream
+			{
+				int ones = 0;
+				for (uint8_t i = 0; i < 16; i++)
+					ones += __builtin_popcount(payload[i]);
+				return 64 - abs(ones - 64);
+			}
+
+			uint32_t s = 0;
+			for (int i = 0; i < n; i++)
+			{
+				if (c.have_prev)
+					s += abs(wo[i] - c.prev_wo) + 4 * abs(e[i] - c.prev_e);
+				c.prev_wo = wo[i];
+				c.prev_e = e[i];
+				c.have_prev = true;
+			}
+			return s;
+		}
+
+		bool keyring::decrypt(uint8_t payload[16], uint16_t fn)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			if (_cand.empty())
+				return false;
+
+			if (_frames >= KEYRING_TRIAL_FRAMES)
+			{
+				crypt(_entries[_cand[_best].entry], payload, fn);
+				return false;
+			}
+
+			uint8_t best[16];
+			for (size_t i = 0; i < _cand.size(); i++)
+			{
+				uint8_t p[16];
+				memcpy(p, payload, sizeof(p));
+				crypt(_entries[_cand[i].entry], p, fn);
+				_cand[i].score += score(_cand[i], p);
+
+				if (i == 0 || _cand[i].score < _cand[_best].score)
+				{
+					_best = i;
+					memcpy(best, p, sizeof(best));
+				}
+			}
+			memcpy(payload, best, sizeof(best));
+
+			return ++_frames == KEYRING_TRIAL_FRAMES;
+		}
+
+		int keyring::candidates()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _cand.size();
+		}
+
+		int keyring::winner()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _cand.empty() ? -1 : _cand[_best].entry;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_KEYRING_H
+#define INCLUDED_M17_KEYRING_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "m17.h"
+#include "aes_engine.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * AES keys and scrambler seeds of several talk groups. At the start of an
+ * encrypted stream, the entries matching its CAN, destination and
+ * encryption type are candidates; each frame is decrypted with all of
+ * them and scored by how plausible the plaintext is (codec2 pitch and
+ * energy move slowly between speech frames, decrypted with a wrong key
+ * they are uniformly random). The output uses the best candidate so far,
+ * and after KEYRING_TRIAL_FRAMES frames it is kept for the rest of the
+ * stream. Each AES candidate keeps its key schedule.
+ */
+    class keyring
+    {
+    public:
+#define KEYRING_TRIAL_FRAMES 4	//stream frames (160 ms) before the key is fixed
+      // entries "selector=aes:hexkey" or "selector=scr:hexseed" separated by
+      // commas, semicolons or whitespace; selector: *, a destination
+      // callsign, can:N or can:N/callsign; returns the number loaded
+      int load (const std::string & keys);
+
+      // new stream, or a new LSF for the current one (late entry); the trial
+      // goes on if the LSF is the one it runs on; returns the number of
+      // candidates (0 - keyring not used)
+      int start (const lsf_t * lsf);
+      // decrypt one frame of the current stream in place; true when this
+      // frame fixed the key, whose index is then in winner ()
+      bool decrypt (uint8_t payload[16], uint16_t fn);
+      int candidates ();
+      int winner ();
+
+      // codec2 pitch (Wo) and energy indexes of the voice frames in a payload
+      // of the given LSF TYPE, as packed by codec2_encode_3200 () and
+      // codec2_encode_1600 (); returns their number, 0 for data
+      static int codec2_params (uint16_t type, const uint8_t payload[16],
+				uint16_t wo[2], uint16_t e[2]);
+
+    private:
+      typedef struct
+      {
+	int8_t can;		//-1 - any
+	bool any_dst;
+	uint8_t dst[6];		//encoded destination callsign
+	uint8_t encr;		//LSF encryption type: 1 - scrambler, 2 - AES
+	uint8_t key[32];	//AES key
+	uint32_t seed;		//scrambler seed
+	aes_engine aes;
+      } entry_t;
+
+      typedef struct
+      {
+	int entry;		//index in _entries
+	uint32_t score;		//sum of the frame scores, lower is more plausible
+	bool have_prev;
+	uint16_t prev_wo, prev_e;	//codec2 parameters of the previous frame
+      } candidate_t;
+
+        std::vector < entry_t > _entries;
+        std::vector < candidate_t > _cand;
+        std::mutex _mutex;
+      bool _started = false;	//a trial was started since the last load
+      uint16_t _type = 0;	//LSF TYPE of the stream
+      uint8_t _dst[6];		//encoded destination callsign
+      uint8_t _meta[14];	//AES IV
+      int _frames = 0;		//frames tried
+      int _best = -1;		//index in _cand
+
+      void crypt (entry_t & e, uint8_t payload[16], uint16_t fn);
+      uint32_t score (candidate_t & c, const uint8_t payload[16]);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_KEYRING_H */
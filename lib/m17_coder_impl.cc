@@ -94,7 +94,7 @@ namespace gr
       }
 #endif
       /*
-            uint16_t ccrc = LSF_CRC (&_lsf);
+            uint16_t ccrc = lsf_crc (&_lsf);
               _lsf.crc[0] = ccrc >> 8;
               _lsf.crc[1] = ccrc & 0xFF;
       */
@@ -150,7 +150,7 @@ namespace gr
 
         // calculate LSF CRC (unclear whether or not this is only
         // needed here for debug, or if this is missing on every initial LSF)
-        update_LSF_CRC(&_lsf);
+        update_lsf_crc(&_lsf);
       }
 #ifdef AES
       if (_encr_type == ENCR_AES)
@@ -160,7 +160,7 @@ namespace gr
         _iv[15] = (_fn >> 0) & 0xFF;
 
         // re-calculate LSF CRC with IV insertion
-        update_LSF_CRC(&_lsf);
+        update_lsf_crc(&_lsf);
       }
 //        srand (time (NULL));	//random number generator (for IV rand() seed value)
 //        memset (_key, 0, 32 * sizeof (uint8_t));
@@ -263,7 +263,7 @@ namespace gr
       }
       encode_callsign_bytes(_lsf.src, _src_id); // 6 byte ID <- 9 char callsign
 
-      uint16_t ccrc = LSF_CRC(&_lsf);
+      uint16_t ccrc = lsf_crc(&_lsf);
       _lsf.crc[0] = ccrc >> 8;
       _lsf.crc[1] = ccrc & 0xFF;
     }
@@ -284,7 +284,7 @@ namespace gr
         _dst_id[i] = toupper(dst_id.c_str()[i]);
       }
       encode_callsign_bytes(_lsf.dst, _dst_id); // 6 byte ID <- 9 char callsign
-      uint16_t ccrc = LSF_CRC(&_lsf);
+      uint16_t ccrc = lsf_crc(&_lsf);
       _lsf.crc[0] = ccrc >> 8;
       _lsf.crc[1] = ccrc & 0xFF;
     }
@@ -347,6 +347,7 @@ namespace gr
         fprintf(stderr, "%02X ", _key[i]);
       fprintf(stderr, "\n");
       fflush(stdout);
+      _aes.set_key(_key, _aes_subtype);
     }
 
     void m17_coder_impl::set_seed(std::string arg) // *UTF-8* encoded byte array
@@ -449,7 +450,7 @@ namespace gr
         fprintf(stderr, "\n");
       }
       fflush(stdout);
-      uint16_t ccrc = LSF_CRC(&_lsf);
+      uint16_t ccrc = lsf_crc(&_lsf);
       _lsf.crc[0] = ccrc >> 8;
       _lsf.crc[1] = ccrc & 0xFF;
     }
@@ -492,6 +493,7 @@ namespace gr
       else
         fprintf(stderr, "ERROR: encryption type != AES");
       fprintf(stderr, "\n");
+      _aes.set_key(_key, _aes_subtype);
     }
 
     void m17_coder_impl::set_can(int can)
@@ -509,7 +511,7 @@ namespace gr
           mode | (data << 1) | (encr_type << 3) | (encr_subtype << 5) | (can << 7);
       _lsf.type[0] = tmptype >> 8;   // MSB
       _lsf.type[1] = tmptype & 0xff; // LSB
-      uint16_t ccrc = LSF_CRC(&_lsf);
+      uint16_t ccrc = lsf_crc(&_lsf);
       _lsf.crc[0] = ccrc >> 8;
       _lsf.crc[1] = ccrc & 0xFF;
       fprintf(stderr, "Transmission type: 0x%02X%02X\n", _lsf.type[0], _lsf.type[1]);
@@ -533,69 +535,26 @@ namespace gr
     // scrambler PN sequence generation
     void m17_coder_impl::scrambler_sequence_generator()
     {
-      int i = 0;
-      uint32_t lfsr, bit;
-      lfsr = _scrambler_seed;
+      const uint32_t seed = _scrambler_seed;
 
       // only set if not initially set (first run), it is possible (and observed) that the scrambler_subtype can
       // change on subsequent passes if the current SEED for the LFSR falls below one of these thresholds
       if (_scrambler_subtype == -1)
-      {
-        if (lfsr > 0 && lfsr <= 0xFF)
-          _scrambler_subtype = 0; // 8-bit key
-        else if (lfsr > 0xFF && lfsr <= 0xFFFF)
-          _scrambler_subtype = 1; // 16-bit key
-        else if (lfsr > 0xFFFF && lfsr <= 0xFFFFFF)
-          _scrambler_subtype = 2; // 24-bit key
-        else
-          _scrambler_subtype = 0; // 8-bit key (default)
-      }
+        _scrambler_subtype = scrambler::subtype(seed);
+
+      // 16 bytes of PN sequence, the seed is saved for the next round
+      scrambler::keystream(_scrambler_subtype, &_scrambler_seed, _scr_bytes);
 
       // TODO: Set Frame Type based on scrambler_subtype value
       if (_debug == true)
       {
         fprintf(stderr,
-                "\nScrambler Key: 0x%06X; Seed: 0x%06X; Subtype: %02d;",
-                _scrambler_seed, lfsr, _scrambler_subtype);
+                "\nScrambler Seed: 0x%06X; Subtype: %02d;",
+                seed, _scrambler_subtype);
         fprintf(stderr, "\n PN: ");
-      }
-
-      // run PN sequence with taps specified
-      for (i = 0; i < 128; i++)
-      {
-        // get feedback bit with specified taps, depending on the scrambler_subtype
-        if (_scrambler_subtype == 0)
-          bit = (lfsr >> 7) ^ (lfsr >> 5) ^ (lfsr >> 4) ^ (lfsr >> 3);
-        else if (_scrambler_subtype == 1)
-          bit = (lfsr >> 15) ^ (lfsr >> 14) ^ (lfsr >> 12) ^ (lfsr >> 3);
-        else if (_scrambler_subtype == 2)
-          bit = (lfsr >> 23) ^ (lfsr >> 22) ^ (lfsr >> 21) ^ (lfsr >> 16);
-        else
-          bit = 0; // should never get here, but just in case
-
-        bit &= 1;                 // truncate bit to 1 bit (required since I didn't do it above)
-        lfsr = (lfsr << 1) | bit; // shift LFSR left once and OR bit onto LFSR's LSB
-        lfsr &= 0xFFFFFF;         // truncate lfsr to 24-bit (really doesn't matter)
-        _scrambler_pn[i] = bit;
-      }
-      // pack bit array into byte array for easy data XOR
-      pack_bit_array_into_byte_array(_scrambler_pn, _scr_bytes, 16);
-
-      // save scrambler seed for next round
-      _scrambler_seed = lfsr;
 
-      // truncate seed so subtype will continue to set properly on subsequent passes
-      if (_scrambler_subtype == 0)
-        _scrambler_seed &= 0xFF;
-      else if (_scrambler_subtype == 1)
-        _scrambler_seed &= 0xFFFF;
-      else if (_scrambler_subtype == 2)
-        _scrambler_seed &= 0xFFFFFF;
-
-      if (_debug == true)
-      {
         // debug packed bytes
-        for (i = 0; i < 16; i++)
+        for (uint8_t i = 0; i < 16; i++)
           fprintf(stderr, " %02X", _scr_bytes[i]);
         fprintf(stderr, "\n");
       }
@@ -707,7 +666,7 @@ namespace gr
             if (!_got_lsf) // stream frames
             {
               // send LSF
-              gen_frame(out + countout, NULL, FRAME_LSF, &_lsf, 0, 0);
+              frame_encoder::gen_frame(out + countout, NULL, FRAME_LSF, &_lsf, 0, 0);
               countout += SYM_PER_FRA; // gen frame always writes SYM_PER_FRA symbols = 192
 
               // check the SIGNED STREAM flag
@@ -738,7 +697,7 @@ namespace gr
               memcpy(&(_next_lsf.meta), _iv, 14); // TODO: I suspect that this does not work
               _iv[14] = (_fn >> 8) & 0x7F;
               _iv[15] = (_fn >> 0) & 0xFF;
-              aes_ctr_bytewise_payload_crypt(_iv, _key, data, _aes_subtype);
+              _aes.ctr_crypt(_iv, data);
             }
             else
 #endif
@@ -760,7 +719,7 @@ namespace gr
 
           if (_finished.load(std::memory_order_acquire) == false)
           {
-            gen_frame(out + countout, data, FRAME_STR, &_lsf, _lich_cnt, _fn);
+            frame_encoder::gen_frame(out + countout, data, FRAME_STR, &_lsf, _lich_cnt, _fn);
             countout += SYM_PER_FRA;         // gen frame always writes SYM_PER_FRA symbols = 192
             _fn = (_fn + 1) % 0x8000;        // increment FN
             _lich_cnt = (_lich_cnt + 1) % 6; // continue with next LICH_CNT
@@ -781,7 +740,7 @@ namespace gr
             {
               // TODO: fix the _next_lsf contents before uncommenting lines below
               //_lsf = _next_lsf;
-              // update_LSF_CRC(&_lsf);
+              // update_lsf_crc(&_lsf);
             }
           }
           else // send last frame(s)
@@ -817,7 +776,7 @@ namespace gr
 
             if (!_signed_str)
               _fn |= 0x8000;
-            gen_frame(out + countout, data, FRAME_STR, &_lsf, _lich_cnt, _fn);
+            frame_encoder::gen_frame(out + countout, data, FRAME_STR, &_lsf, _lich_cnt, _fn);
             countout += SYM_PER_FRA;         // gen frame always writes SYM_PER_FRA symbols = 192
             _lich_cnt = (_lich_cnt + 1) % 6; // continue with next LICH_CNT
 
@@ -839,7 +798,7 @@ namespace gr
               _fn = 0x7FFC; // signature has to start at 0x7FFC to end at 0x7FFF (0xFFFF with EoT marker set)
               for (uint8_t i = 0; i < 4; i++)
               {
-                gen_frame(out + countout, &_sig[i * 16], FRAME_STR, &_lsf, _lich_cnt, _fn);
+                frame_encoder::gen_frame(out + countout, &_sig[i * 16], FRAME_STR, &_lsf, _lich_cnt, _fn);
                 countout += SYM_PER_FRA; // gen frame always writes SYM_PER_FRA symbols = 192
                 _fn = (_fn < 0x7FFE) ? _fn + 1 : (0x7FFF | 0x8000);
                 _lich_cnt = (_lich_cnt + 1) % 6; // continue with next LICH_CNT
@@ -14,6 +14,10 @@
 #include <atomic>
 #include <gnuradio/m17/m17_coder.h>
 #include "m17.h"		// lsf_t declaration
+#include "aes_engine.h"
+#include "frame_encoder.h"
+#include "m17_tables.h"
+#include "scrambler.h"
 
 #ifdef AES
 #include "aes.h"
@@ -49,8 +53,9 @@ namespace gr
 	AES192,
 	AES256
       } aes_t;
-      uint8_t _key[32];
+      uint8_t _key[32] = { 0 };
       uint8_t _iv[16];
+      aes_engine _aes;		//key schedule of _key and _aes_subtype
       time_t epoch = 1577836800L;	//Jan 1, 2020, 00:00:00 UTC
 #endif
       int _can;
@@ -75,7 +80,6 @@ namespace gr
 //Scrambler
       uint8_t _seed[3]; //24-bit is the largest seed value
       uint8_t _scr_bytes[16];
-      uint8_t _scrambler_pn[128];
       uint32_t _scrambler_seed = 0;
       int8_t _scrambler_subtype = -1;
 #endif
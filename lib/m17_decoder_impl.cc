@@ -29,7 +29,9 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <algorithm>
 
 #include "m17.h"
 
@@ -41,10 +43,10 @@ namespace gr
 		m17_decoder::sptr
 		m17_decoder::make(bool debug_data, bool debug_ctrl, float sw_threshold,
 						  float vt_threshold, bool callsign, bool signed_str, int encr_type,
-						  std::string key, std::string seed)
+						  std::string key, std::string seed, int input_type, int sps)
 		{
 			return gnuradio::get_initial_sptr(new m17_decoder_impl(debug_data, debug_ctrl, sw_threshold, vt_threshold, callsign,
-																   signed_str, encr_type, key, seed));
+																   signed_str, encr_type, key, seed, input_type, sps));
 		}
 
 		/*
@@ -54,12 +56,18 @@ namespace gr
 										   float sw_threshold, float vt_threshold,
 										   bool callsign, bool signed_str,
 										   int encr_type,
-										   std::string key, std::string seed) : gr::block("m17_decoder",
-																						  gr::io_signature::make(1, 1, sizeof(float)),
-																						  gr::io_signature::make(1, 1, sizeof(char))),
+										   std::string key, std::string seed,
+										   int input_type, int sps) : gr::block("m17_decoder",
+																				gr::io_signature::make(1, 1, symbol_frontend::item_size(input_type)),
+																				gr::io_signature::make(0, FILTER_MAX_PORTS, sizeof(char))), // none needed for PDUs
 																				_debug_data(debug_data), _debug_ctrl(debug_ctrl),
 																				_sw_threshold(sw_threshold), _vt_threshold(vt_threshold),
-																				_callsign(callsign), _signed_str(signed_str)
+																				_callsign(callsign), _signed_str(signed_str),
+																				_frontend(input_type, sps),
+																				_symbol_input(input_type == INPUT_FLOAT && sps == 1),
+																				_item_size(symbol_frontend::item_size(input_type)),
+																				_verifier([this](const signature_verifier::job_t &job)
+																						  { signature_checked(job); })
 		{
 			set_debug_data(debug_data);
 			set_debug_ctrl(debug_ctrl);
@@ -70,8 +78,11 @@ namespace gr
 			set_key(key);
 			set_encr_type(encr_type);
 			_expected_next_fn = 0;
+			printf("Viterbi decoder: %s\n", _viterbi.impl_name());
 
-			message_port_register_out(pmt::mp("fields"));
+			message_port_register_out(_pmt_fields);
+			message_port_register_out(_pmt_pdu);
+			message_port_register_out(pmt::mp("signature"));
 		}
 
 		/*
@@ -79,11 +90,39 @@ namespace gr
 		 */
 		m17_decoder_impl::~m17_decoder_impl()
 		{
+			_verifier.stop(); // before the members its callback uses go away
+		}
+
+		// called on a verifier thread once a stream signature has been checked
+		void m17_decoder_impl::signature_checked(const signature_verifier::job_t &job)
+		{
+			uint8_t dst[12], src[12];
+			decode_callsign_bytes(dst, job.lsf.dst);
+			decode_callsign_bytes(src, job.lsf.src);
+
+			pmt::pmt_t dict = pmt::make_dict();
+			dict = pmt::dict_add(dict, pmt::mp("src"), pmt::intern((char *)src));
+			dict = pmt::dict_add(dict, pmt::mp("dst"), pmt::intern((char *)dst));
+			dict = pmt::dict_add(dict, pmt::mp("type"), pmt::init_u8vector(2, job.lsf.type));
+			dict = pmt::dict_add(dict, pmt::mp("meta"), pmt::init_u8vector(14, job.lsf.meta));
+			dict = pmt::dict_add(dict, pmt::mp("valid"), pmt::from_bool(job.valid));
+
+			message_port_pub(pmt::mp("signature"), dict);
+
+			if (_debug_ctrl == true)
+			{
+				if (job.valid)
+					printf("Signature OK (%s)\n", src);
+				else
+					printf("Signature invalid (%s)\n", src);
+			}
 		}
 
 		void m17_decoder_impl::set_sw_threshold(float sw_threshold)
 		{
+			gr::thread::scoped_lock lock(d_setlock);
 			_sw_threshold = sw_threshold;
+			_correlator.set_threshold(_sw_threshold);
 			printf("Syncword threshold: %.1f\n", _sw_threshold);
 		}
 
@@ -93,6 +132,75 @@ namespace gr
 			printf("Viterbi threshold: %.1f\n", _vt_threshold);
 		}
 
+		void m17_decoder_impl::set_flywheel(int max_misses)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_fw_max_misses = (max_misses > 0) ? max_misses : 0;
+			if (_fw_max_misses == 0)
+				_locked = false;
+			printf("Flywheel: %d misses\n", _fw_max_misses);
+		}
+
+		void m17_decoder_impl::set_false_alarm_rate(float pfa)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_pfa = pfa;
+			_correlator.set_false_alarm_rate(_pfa);
+			if (_pfa > 0.0f)
+				printf("Adaptive syncword threshold, false alarm rate: %.1e\n", _pfa);
+			else
+			{
+				_correlator.set_threshold(_sw_threshold);
+				printf("Fixed syncword threshold: %.1f\n", _sw_threshold);
+			}
+		}
+
+		void m17_decoder_impl::set_squelch(float hang_time)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_sq_hang_len = (hang_time > 0) ? (int)(hang_time * 4800) : 0;
+			_sq_open = false;
+			_sq_floor = 0;
+			_sq_blocks = 0;
+			_sq_cnt = 0;
+			_sq_sum = _sq_sum2 = _sq_alt = 0;
+			printf("Squelch hang time: %1.2f s\n", (float)_sq_hang_len / 4800);
+		}
+
+		bool m17_decoder_impl::squelch_open()
+		{
+			return (_sq_hang_len == 0) || _sq_open || _locked;
+		}
+
+		void m17_decoder_impl::set_normalize(bool normalize)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_normalize = normalize;
+			_correlator.set_dc_removal(_normalize);
+			_frontend.set_dc_removal(_normalize);
+			printf("Syncword-driven normalization: %s\n", _normalize ? "on" : "off");
+		}
+
+		void m17_decoder_impl::set_soft_bits(int bits)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_soft8 = (bits == 8);
+			// partially sliced candidates are in the other format
+			_n_hyp = 0;
+			_locked = false;
+			printf("Soft bits: %d\n", _soft8 ? 8 : 16);
+		}
+
+		float m17_decoder_impl::sw_threshold()
+		{
+			return _correlator.threshold();
+		}
+
+		float m17_decoder_impl::false_sync_rate()
+		{
+			return _false_sync_rate;
+		}
+
 		void m17_decoder_impl::set_debug_data(bool debug)
 		{
 			_debug_data = debug;
@@ -113,6 +221,7 @@ namespace gr
 
 		void m17_decoder_impl::set_encr_type(int encr_type)
 		{
+			gr::thread::scoped_lock lock(d_setlock);
 			switch (encr_type)
 			{
 			case 0:
@@ -153,6 +262,7 @@ namespace gr
 
 		void m17_decoder_impl::set_key(std::string arg) // *UTF-8* encoded byte array
 		{
+			gr::thread::scoped_lock lock(d_setlock);
 			int length;
 			printf("new key: ");
 			length = arg.size();
@@ -178,10 +288,45 @@ namespace gr
 				printf("%02X ", _key[i]);
 			printf("\n");
 			fflush(stdout);
+#ifdef AES
+			_aes.set_key(_key, _aes_subtype);
+#endif
+		}
+
+		void m17_decoder_impl::set_pub_keys(std::string keys)
+		{
+			printf("Public keys: %d loaded\n", _pub_keys.load(keys));
+			fflush(stdout);
+		}
+
+		void m17_decoder_impl::set_filter(std::string rules)
+		{
+			printf("Stream filter: %d rules loaded\n", _filter.load(rules));
+			fflush(stdout);
+			// applied by the work thread from the next LSF or complete LICH on
+		}
+
+		uint64_t m17_decoder_impl::frames_filtered()
+		{
+			return _frames_filtered;
+		}
+
+		void m17_decoder_impl::set_output_mode(int mode)
+		{
+			gr::thread::scoped_lock lock(d_setlock);
+			_output_mode = (mode == OUTPUT_TAGGED || mode == OUTPUT_PDU) ? mode : OUTPUT_STREAM;
+			printf("Output mode: %s\n", _output_mode == OUTPUT_PDU ? "PDU" : _output_mode == OUTPUT_TAGGED ? "tagged stream" : "stream");
+		}
+
+		void m17_decoder_impl::set_keyring(std::string keys)
+		{
+			printf("Keyring: %d entries loaded\n", _keyring.load(keys));
+			fflush(stdout);
 		}
 
 		void m17_decoder_impl::set_seed(std::string arg) // *UTF-8* encoded byte array
 		{
+			gr::thread::scoped_lock lock(d_setlock);
 			int length;
 			printf("new seed: ");
 			length = arg.size();
@@ -219,6 +364,7 @@ namespace gr
 			}
 			else
 				fprintf(stderr, "Scrambler key: 0x%06X (24-bit)\n", _scrambler_seed);
+			_scrambler_key = _scrambler_seed; // the seed of FN 0, the other ones are jumped from it
 
 			_encr_type = ENCR_SCRAM; // Scrambler key was passed
 		}
@@ -232,32 +378,12 @@ namespace gr
 
 		// this is generating a correct seed value based on the fn value,
 		// ideally, we would only want to run this under poor signal, frame skips, etc
-		// Note: Running this every frame will lag if high fn values (observed with test file)
+		// the LFSR jumps by powers of 2 frames, at most 15 jumps for any fn
 		uint32_t m17_decoder_impl::scrambler_seed_calculation(int8_t subtype,
 															  uint32_t key,
 															  int fn)
 		{
-			int i;
-			uint32_t lfsr, bit;
-
-			lfsr = key;
-			bit = 0;
-			for (i = 0; i < 128 * fn; i++)
-			{
-				// get feedback bit with specified taps, depending on the subtype
-				if (subtype == 0)
-					bit = (lfsr >> 7) ^ (lfsr >> 5) ^ (lfsr >> 4) ^ (lfsr >> 3);
-				else if (subtype == 1)
-					bit = (lfsr >> 15) ^ (lfsr >> 14) ^ (lfsr >> 12) ^ (lfsr >> 3);
-				else if (subtype == 2)
-					bit = (lfsr >> 23) ^ (lfsr >> 22) ^ (lfsr >> 21) ^ (lfsr >> 16);
-				else
-					bit = 0; // should never get here, but just in case
-
-				bit &= 1;				  // truncate bit to 1 bit
-				lfsr = (lfsr << 1) | bit; // shift LFSR left once and OR bit onto LFSR's LSB
-				lfsr &= 0xFFFFFF;		  // truncate lfsr to 24-bit
-			}
+			uint32_t lfsr = scrambler::jump(subtype, key, fn);
 
 			// truncate seed so subtype will continue to set properly on subsequent passes
 			if (_scrambler_subtype == 0)
@@ -276,70 +402,26 @@ namespace gr
 		// scrambler pn sequence generation
 		void m17_decoder_impl::scrambler_sequence_generator()
 		{
-			int i = 0;
-			uint32_t lfsr, bit;
-			lfsr = _scrambler_seed;
+			const uint32_t seed = _scrambler_seed;
 
 			// only set if not initially set (first run), it is possible (and observed) that the scrambler_subtype can
 			// change on subsequent passes if the current SEED for the LFSR falls below one of these thresholds
 			if (_scrambler_subtype == -1)
-			{
-				if (lfsr > 0 && lfsr <= 0xFF)
-					_scrambler_subtype = 0; // 8-bit key
-				else if (lfsr > 0xFF && lfsr <= 0xFFFF)
-					_scrambler_subtype = 1; // 16-bit key
-				else if (lfsr > 0xFFFF && lfsr <= 0xFFFFFF)
-					_scrambler_subtype = 2; // 24-bit key
-				else
-					_scrambler_subtype = 0; // 8-bit key (default)
-			}
+				_scrambler_subtype = scrambler::subtype(seed);
+
+			// 16 bytes of pN sequence, the seed is saved for the next round
+			scrambler::keystream(_scrambler_subtype, &_scrambler_seed, _scr_bytes);
 
 			// TODO: Set Frame Type based on scrambler_subtype value
 			if (_debug_ctrl == true)
 			{
 				fprintf(stderr,
 						"\nScrambler Key: 0x%06X; Seed: 0x%06X; Subtype: %02d;",
-						_scrambler_seed, lfsr, _scrambler_subtype);
+						_scrambler_key, seed, _scrambler_subtype);
 				fprintf(stderr, "\n pN: ");
-			}
-
-			// run pN sequence with taps specified
-			for (i = 0; i < 128; i++)
-			{
-				// get feedback bit with specified taps, depending on the scrambler_subtype
-				if (_scrambler_subtype == 0)
-					bit = (lfsr >> 7) ^ (lfsr >> 5) ^ (lfsr >> 4) ^ (lfsr >> 3);
-				else if (_scrambler_subtype == 1)
-					bit = (lfsr >> 15) ^ (lfsr >> 14) ^ (lfsr >> 12) ^ (lfsr >> 3);
-				else if (_scrambler_subtype == 2)
-					bit = (lfsr >> 23) ^ (lfsr >> 22) ^ (lfsr >> 21) ^ (lfsr >> 16);
-				else
-					bit = 0; // should never get here, but just in case
-
-				bit &= 1;				  // truncate bit to 1 bit (required since I didn't do it above)
-				lfsr = (lfsr << 1) | bit; // shift LFSR left once and OR bit onto LFSR's LSB
-				lfsr &= 0xFFFFFF;		  // truncate lfsr to 24-bit (really doesn't matter)
-				_scrambler_pn[i] = bit;
-			}
 
-			// pack bit array into byte array for easy data XOR
-			pack_bit_array_into_byte_array(_scrambler_pn, _scr_bytes, 16);
-
-			// save scrambler seed for next round
-			_scrambler_seed = lfsr;
-
-			// truncate seed so subtype will continue to set properly on subsequent passes
-			if (_scrambler_subtype == 0)
-				_scrambler_seed &= 0xFF;
-			else if (_scrambler_subtype == 1)
-				_scrambler_seed &= 0xFFFF;
-			else if (_scrambler_subtype == 2)
-				_scrambler_seed &= 0xFFFFFF;
-
-			if (_debug_ctrl == true)
-			{
 				// debug packed bytes
-				for (i = 0; i < 16; i++)
+				for (uint8_t i = 0; i < 16; i++)
 					fprintf(stderr, " %02X", _scr_bytes[i]);
 				fprintf(stderr, "\n");
 			}
@@ -403,404 +485,1087 @@ namespace gr
 			}
 		}
 
-		int
-		m17_decoder_impl::general_work(int noutput_items,
-									   gr_vector_int &ninput_items,
-									   gr_vector_const_void_star &input_items,
-									   gr_vector_void_star &output_items)
+		// everything done with a stream frame once it has been accepted; lich_ok false
+		// means a locked frame whose LICH did not decode, only its payload is used
+		int m17_decoder_impl::process_stream_frame(uint32_t e, char *out, bool lich_ok)
 		{
-			const float *in = (const float *)input_items[0];
-			char *out = (char *)output_items[0];
-			int countout = 0;
+			uint16_t type = ((uint16_t)_lsf.type[0] << 8) + _lsf.type[1];
+			_signed_str = (type >> 11) & 1;
+
+			/// if the stream is signed (process before decryption)
+			if (_signed_str && _fn < 0x7FFC)
+			{
+				if (_fn == 0)
+					memset(_digest, 0, sizeof(_digest));
+
+				for (uint8_t i = 0; i < sizeof(_digest); i++)
+					_digest[i] ^= _frame_data[i];
+				uint8_t tmp = _digest[0];
+				for (uint8_t i = 0; i < sizeof(_digest) - 1; i++)
+					_digest[i] = _digest[i + 1];
+				_digest[sizeof(_digest) - 1] = tmp;
+			}
+
+			// NOTE: Don't attempt decryption when a signed stream is >= 0x7FFC
+			// The Signature is not encrypted
+
+			// Keyring: the key of the stream is picked by trial decryption; on a late
+			// entry this LSF may be stale, the trial restarts once the LICH gives the LSF
+			if (!_stream_active && lsf_crc_ok(&_lsf))
+				_keyring.start(&_lsf);
+			const bool use_keyring = (_keyring.candidates() > 0);
+
+			if (use_keyring && (!_signed_str || (_fn % 0x8000) < 0x7FFC))
+			{
+				if (_keyring.decrypt(_frame_data, _fn & 0x7FFF) && _debug_ctrl == true)
+					printf("Keyring: entry %d picked out of %d\n", _keyring.winner(), _keyring.candidates());
+			}
+
+			// AES
+			if (!use_keyring && _encr_type == ENCR_AES)
+			{
+				memcpy(_iv, _lsf.meta, 14);
+				_iv[14] = (_fn >> 8) & 0x7F; // TODO: check if this is the right byte order
+				_iv[15] = (_fn & 0xFF) & 0xFF;
 
-			float sample; // last raw sample from the stdin
-			float dist;	  // Euclidean distance for finding syncwords in the symbol stream
+				_aes_subtype = (type >> 5) & 3;
+				_aes.set_key(_key, _aes_subtype); // only expands the key schedule when it changed
 
-			for (int counterin = 0; counterin < ninput_items[0]; counterin++)
+				if (_signed_str && (_fn % 0x8000) < 0x7FFC) // signed stream
+					_aes.ctr_crypt(_iv, _frame_data);
+				else if (!_signed_str) // non-signed stream
+					_aes.ctr_crypt(_iv, _frame_data);
+			}
+
+			// Scrambler
+			if (!use_keyring && _encr_type == ENCR_SCRAM)
 			{
-				// wait for another symbol
-				sample = in[counterin];
+				if (_fn != 0 && (_fn % 0x8000) != _expected_next_fn) // frame skip, etc
+					_scrambler_seed = scrambler_seed_calculation(_scrambler_subtype, _scrambler_key, _fn & 0x7FFF);
+				else if (_fn == 0)
+					_scrambler_seed = _scrambler_key; // reset back to key value
+
+				if (_signed_str && (_fn % 0x8000) < 0x7FFC) // signed stream
+					scrambler_sequence_generator();
+				else if (!_signed_str) // non-signed stream
+					scrambler_sequence_generator();
+				else
+					memset(_scr_bytes, 0, sizeof(_scr_bytes)); // zero out stale scrambler bytes so they aren't applied to the sig frames
 
-				if (!syncd)
+				for (uint8_t i = 0; i < 16; i++)
 				{
-					// push new symbol
-					for (uint8_t i = 0; i < 7; i++)
-					{
-						last[i] = last[i + 1];
-					}
+					_frame_data[i] ^= _scr_bytes[i];
+				}
+			}
 
-					last[7] = sample;
+			// dump data
+			if (_debug_data == true)
+			{
+				printf("RX FN: %04X PLD: ", _fn);
+
+				for (uint8_t i = 0; i < 16; i++)
+				{
+					printf("%02X", _frame_data[i]);
+				}
 
-					// calculate euclidean norm
-					dist = eucl_norm(last, str_sync_symbols, 8);
+				printf(" e=%1.1f\n", (float)e / 0xFFFF);
+			}
 
-					if (dist < _sw_threshold) // frame syncword detected
+			// set a threshold on the Viterbi metric to prevent sound artifacts
+			_frame_info.fn = _fn;
+			_frame_info.lich_cnt = _lich_cnt;
+			_frame_info.metric = (float)e / 0xFFFF;
+			_frame_info.erased = (_frame_info.metric > _vt_threshold);
+			if (!_frame_info.erased)
+				memcpy(out, _frame_data, 16);
+			else
+				memset(out, 0, 16);
+
+			// send codec2 stream to stdout
+			// fwrite(_frame_data, 16, 1, stdout);
+
+			// a LICH that did not decode is not part of the LSF, the chunk is missed
+			const bool lich_chunk_ok = lich_ok && _lich_cnt < 6;
+
+			// If we're at the start of a superframe, or we missed a frame, reset the LICH state
+			if ((lich_chunk_ok && _lich_cnt == 0) || ((_fn % 0x8000) != _expected_next_fn && _fn < 0x7FFC))
+				lich_chunks_rcvd = 0;
+
+			if (lich_chunk_ok)
+			{
+				lich_chunks_rcvd |= (1 << _lich_cnt);
+				memcpy((uint8_t *)&_lsf + _lich_cnt * 5, _lich_b, 5);
+			}
+
+			// debug - dump LICH
+			if (lich_chunk_ok && lich_chunks_rcvd == 0x3F) // all 6 chunks received?
+			{
+				// a chunk may have been decoded wrong, only an intact LSF is used
+				const bool lsf_ok = lsf_crc_ok(&_lsf);
+
+				if (lsf_ok)
+				{
+					apply_filter(); // late entry: the first LSF of the stream
+					_keyring.start(&_lsf); // no-op unless the trial started on another LSF
+				}
+
+				// handle message output, only when something changed
+				if (lsf_ok && _stream_port >= 0 && (!_fields_active || memcmp(&_lsf, &_fields_lsf, sizeof(lsf_t)) != 0))
+				{
+					// other callsigns or type: another stream, its LSF and EoT were missed
+					if (_fields_active && memcmp(&_lsf, &_fields_lsf, offsetof(lsf_t, meta)) != 0)
+						publish_fields(_pmt_end, &_fields_lsf);
+					publish_fields(_fields_active ? _pmt_update : _pmt_start, &_lsf);
+				}
+
+				// debug data display
+				if (_callsign == true)
+				{
+					if (_debug_ctrl == true)
 					{
-						// fprintf(stderr, "str_sync_symbols dist: %3.5f\n", dist);
-						syncd = 1;
-						pushed = 0;
-						fl = 0;
+						decode_callsign_bytes(d_dst, _lsf.dst);
+						decode_callsign_bytes(d_src, _lsf.src);
+						printf("DST: %-9s ", d_dst); // DST
+						printf("SRC: %-9s ", d_src); // SRC
 					}
+				}
+				else if (_debug_ctrl == true)
+				{
+					printf("DST: "); // DST
+					for (uint8_t i = 0; i < 6; i++)
+						printf("%02X", ((uint8_t *)_lsf.dst)[i]);
+					printf(" ");
+					printf("SRC: "); // SRC
+					for (uint8_t i = 0; i < 6; i++)
+						printf("%02X", ((uint8_t *)_lsf.src)[i]);
+					printf(" ");
+				}
+
+				// TYPE
+				if (_debug_ctrl == true)
+				{
+					printf("TYPE: %04X (", type);
+					if (type && 1)
+						printf("STREAM: ");
 					else
+						printf("PACKET: "); // shouldn't happen
+					if (((type >> 1) & 3) == 1)
+						printf("DATA, ");
+					else if (((type >> 1) & 3) == 2)
+						printf("VOICE, ");
+					else if (((type >> 1) & 3) == 3)
+						printf("VOICE+DATA, ");
+					printf("ENCR: ");
+					if (((type >> 3) & 3) == 0)
+						printf("PLAIN, ");
+					else if (((type >> 3) & 3) == 1)
 					{
-						// calculate euclidean norm again, this time against LSF syncword
-						dist = eucl_norm(last, lsf_sync_symbols, 8);
+						printf("SCRAM ");
+						if (((type >> 5) & 3) == 1)
+							printf("8-bit, ");
+						else if (((type >> 5) & 3) == 2)
+							printf("16-bit, ");
+						else if (((type >> 5) & 3) == 3)
+							printf("24-bit, ");
+					}
+					else if (((type >> 3) & 3) == 2)
+						printf("AES, ");
+					else
+						printf("UNK, ");
+					printf("CAN: %d", (type >> 7) & 0xF);
+					if ((type >> 11) & 1)
+						printf(", SIGNED");
+					printf(") ");
+				}
 
-						if (dist < _sw_threshold) // LSF syncword
-						{
-							// fprintf(stderr, "lsf_sync dist: %3.5f\n", dist);
-							syncd = 1;
-							pushed = 0;
-							fl = 1;
-						}
+				// META
+				if (_debug_ctrl == true)
+				{
+					printf("META: ");
+					for (uint8_t i = 0; i < 14; i++)
+						printf("%02X", ((uint8_t *)_lsf.meta)[i]);
+
+					if (crc_m17((uint8_t *)&_lsf, sizeof(_lsf))) // CRC
+						printf(" LSF_CRC_ERR");
+					else
+						printf(" LSF_CRC_OK ");
+					printf("\n");
+				}
+			}
+
+			// if the contents of the payload is now digital signature, not data/voice
+			if (_fn >= 0x7FFC && _signed_str == true)
+			{
+				memcpy(&_sig[((_fn & 0x7FFF) - 0x7FFC) * 16], _frame_data, 16);
+
+				if (_fn == (0x7FFF | 0x8000))
+				{
+					// dump data
+					/*printf("DEC-Digest: ");
+					   for(uint8_t i=0; i<sizeof(digest); i++)
+					   printf("%02X", digest[i]);
+					   printf("\n");
+
+					   printf("Key: ");
+					   for(uint8_t i=0; i<sizeof(pub_key); i++)
+					   printf("%02X", pub_key[i]);
+					   printf("\n");
+
+					   printf("Signature: ");
+					   for(uint8_t i=0; i<sizeof(sig); i++)
+					   printf("%02X", sig[i]);
+					   printf("\n"); */
+
+					// checked by a worker thread, the result goes to the signature port
+					signature_verifier::job_t job;
+					job.lsf = _lsf;
+					memcpy(job.digest, _digest, sizeof(job.digest));
+					memcpy(job.sig, _sig, sizeof(job.sig));
+					if (!_pub_keys.find(_lsf.src, job.key)) // station without its own key
+						memcpy(job.key, _key, sizeof(job.key));
+					if (!_verifier.submit(job) && _debug_ctrl == true)
+						printf("Signature check dropped, %lu pending\n", (unsigned long)SIG_MAX_JOBS);
+				}
+			}
+
+			_expected_next_fn = (_fn + 1) % 0x8000;
+
+			return 16;
+		}
+
+		// everything done with an LSF once it has been accepted
+		void m17_decoder_impl::process_lsf(uint32_t e)
+		{
+			if (_debug_ctrl == true)
+			{
+				printf("{LSF} ");
+			}
+			// dump data
+			if (_callsign == true)
+			{
+				decode_callsign_bytes(d_dst, _lsf.dst);
+				decode_callsign_bytes(d_src, _lsf.src);
+				if (_debug_ctrl == true)
+				{
+					printf("DST: %-9s ", d_dst); // DST
+					printf("SRC: %-9s ", d_src); // SRC
+				}
+			}
+			else
+			{
+				if (_debug_ctrl == true)
+				{
+					printf("DST: "); // DST
+					for (uint8_t i = 0; i < 6; i++)
+						printf("%02X", ((uint8_t *)_lsf.dst)[i]);
+					printf(" ");
+
+					// SRC
+					printf("SRC: ");
+					for (uint8_t i = 0; i < 6; i++)
+						printf("%02X", ((uint8_t *)_lsf.src)[i]);
+					printf(" ");
+				}
+			}
+			// TYPE
+			uint16_t type = ((uint16_t)_lsf.type[0] << 8) + _lsf.type[1];
+			if (_debug_ctrl == true)
+			{
+				printf("TYPE: %04X (", type);
+				if (type && 1)
+					printf("STREAM: ");
+				else
+					printf("PACKET: "); // shouldn't happen
+				if (((type >> 1) & 3) == 1)
+					printf("DATA, ");
+				else if (((type >> 1) & 3) == 2)
+					printf("VOICE, ");
+				else if (((type >> 1) & 3) == 3)
+					printf("VOICE+DATA, ");
+				printf("ENCR: ");
+				if (((type >> 3) & 3) == 0)
+					printf("PLAIN, ");
+				else if (((type >> 3) & 3) == 1)
+				{
+					printf("SCRAM ");
+					if (((type >> 5) & 3) == 0)
+						printf("8-bit, ");
+					else if (((type >> 5) & 3) == 1)
+						printf("16-bit, ");
+					else if (((type >> 5) & 3) == 2)
+						printf("24-bit, ");
+				}
+				else if (((type >> 3) & 3) == 2)
+				{
+					printf("AES");
+					if (((type >> 5) & 3) == 0)
+						printf("128");
+					else if (((type >> 5) & 3) == 1)
+						printf("192");
+					else if (((type >> 5) & 3) == 2)
+						printf("256");
+
+					printf(", ");
+				}
+				else
+					printf("UNK, ");
+				printf("CAN: %d", (type >> 7) & 0xF);
+				if ((type >> 11) & 1)
+				{
+					printf(", SIGNED");
+					_signed_str = 1;
+				}
+				else
+					_signed_str = 0;
+				printf(") ");
+
+				// META
+				printf("META: ");
+				for (uint8_t i = 0; i < 14; i++)
+					printf("%02X", ((uint8_t *)_lsf.meta)[i]);
+				printf(" ");
+				// CRC
+				// printf("CRC: ");
+				// for(uint8_t i=0; i<2; i++)
+				// printf("%02X", lsf[28+i]);
+				if (crc_m17((uint8_t *)&_lsf, 30))
+					printf("LSF_CRC_ERR");
+				else
+					printf("LSF_CRC_OK ");
+				// Viterbi decoder errors
+				printf(" e=%1.1f\n", (float)e / 0xFFFF);
+			}
+		}
+
+		void m17_decoder_impl::spawn_hypothesis(const sync_correlator::hit_t &hit)
+		{
+			if (_n_hyp == MAX_HYPOTHESES)
+			{
+				// replace the weakest candidate if this syncword matches better
+				uint8_t worst = 0;
+				for (uint8_t i = 1; i < _n_hyp; i++)
+					if (_hyp[i].dist > _hyp[worst].dist)
+						worst = i;
+
+				if (hit.dist >= _hyp[worst].dist)
+					return;
+				drop_hypothesis(worst);
+			}
+
+			_hyp[_n_hyp].pushed = 0;
+			_hyp[_n_hyp].fl = (hit.type == sync_correlator::SYNC_LSF);
+			_hyp[_n_hyp].dist = hit.dist;
+			_hyp[_n_hyp].scale = hit.scale;
+			_hyp[_n_hyp].dc = hit.dc;
+			_n_hyp++;
+		}
+
+		void m17_decoder_impl::drop_hypothesis(uint8_t idx)
+		{
+			// keep the candidates ordered from the oldest
+			for (uint8_t i = idx; i + 1 < _n_hyp; i++)
+				_hyp[i] = _hyp[i + 1];
+			_n_hyp--;
+		}
+
+		// soft bits of one symbol, same arithmetic as libm17's slice_symbols()
+		static inline void slice_symbol(uint16_t out[2], float inp)
+		{
+			if (inp >= symbol_list[3])
+				out[1] = 0xFFFF;
+			else if (inp >= symbol_list[2])
+				out[1] = -(float)0xFFFF / (symbol_list[3] - symbol_list[2]) * symbol_list[2] + inp * (float)0xFFFF / (symbol_list[3] - symbol_list[2]);
+			else if (inp >= symbol_list[1])
+				out[1] = 0x0000;
+			else if (inp >= symbol_list[0])
+				out[1] = (float)0xFFFF / (symbol_list[1] - symbol_list[0]) * symbol_list[1] - inp * (float)0xFFFF / (symbol_list[1] - symbol_list[0]);
+			else
+				out[1] = 0xFFFF;
+
+			if (inp >= symbol_list[2])
+				out[0] = 0x0000;
+			else if (inp >= symbol_list[1])
+				out[0] = 0x7FFF - inp * (float)0xFFFF / (symbol_list[2] - symbol_list[1]);
+			else
+				out[0] = 0xFFFF;
+		}
+
+		// 8-bit soft bits of one symbol, same mapping as slice_symbol()
+		static inline void slice_symbol8(uint8_t out[2], float inp)
+		{
+			if (inp >= symbol_list[3])
+				out[1] = 0xFF;
+			else if (inp >= symbol_list[2])
+				out[1] = (inp - symbol_list[2]) * (float)0xFF / (symbol_list[3] - symbol_list[2]);
+			else if (inp >= symbol_list[1])
+				out[1] = 0x00;
+			else if (inp >= symbol_list[0])
+				out[1] = (symbol_list[1] - inp) * (float)0xFF / (symbol_list[1] - symbol_list[0]);
+			else
+				out[1] = 0xFF;
+
+			if (inp >= symbol_list[2])
+				out[0] = 0x00;
+			else if (inp >= symbol_list[1])
+				out[0] = 0x7F - inp * (float)0xFF / (symbol_list[2] - symbol_list[1]);
+			else
+				out[0] = 0xFF;
+		}
+
+		// add symbols to a candidate: each symbol is sliced straight to its derandomized,
+		// deinterleaved soft bit positions, only the decoding is left for the frame end
+		void m17_decoder_impl::push_symbols(uint8_t idx, const float *in, int len)
+		{
+			hypothesis_t *hyp = &_hyp[idx];
+			const bool norm = _normalize && hyp->scale > NORM_MIN_SCALE;
+			const auto *m = &SOFT_SLOTS.sym[hyp->pushed];
+
+			// the raw symbols are kept, the flywheel reuses the payload tail
+			memcpy(&hyp->pld[hyp->pushed], in, len * sizeof(float));
+			hyp->pushed += len;
+
+			if (_soft8)
+			{
+				for (int i = 0; i < len; i++, m++)
+				{
+					uint8_t sb[2];
+
+					slice_symbol8(sb, norm ? (in[i] - hyp->dc) / hyp->scale : in[i]);
+					hyp->d_soft_bit8[m->pos[0]] = sb[0] ^ (uint8_t)m->flip[0];
+					hyp->d_soft_bit8[m->pos[1]] = sb[1] ^ (uint8_t)m->flip[1];
+				}
+				return;
+			}
+
+			for (int i = 0; i < len; i++, m++)
+			{
+				uint16_t sb[2];
+
+				// undo the DC offset and deviation error measured on the syncword
+				slice_symbol(sb, norm ? (in[i] - hyp->dc) / hyp->scale : in[i]);
+				hyp->d_soft_bit[m->pos[0]] = sb[0] ^ m->flip[0];
+				hyp->d_soft_bit[m->pos[1]] = sb[1] ^ m->flip[1];
+			}
+		}
+
+		// LICH stage of a stream frame: soft Golay decoding of the 4 codewords plus a
+		// reliability check, returns false if the chunk is clearly not a valid LICH;
+		// while searching, the decoding stops as soon as the distance is too large
+		bool m17_decoder_impl::decode_lich(uint8_t lich[6], uint8_t *lich_cnt, const uint16_t inp[96])
+		{
+			uint16_t data[4];
+			uint32_t dist = 0; // soft distance to the decoded codewords
+
+			for (uint8_t i = 0; i < 4; i++)
+			{
+				uint32_t d;
+
+				data[i] = golay_decoder::decode(&inp[i * 24], &d);
+				if (data[i] == 0xFFFF) // not decodable: its 24*0xFFFF alone is within LICH_MAX_DIST
+					return false;
+				dist += d;
+
+				if (!_locked && (float)dist / 0xFFFF > LICH_MAX_DIST)
+					return false;
+			}
+
+			lich[0] = data[0] >> 4;
+			lich[1] = ((data[0] & 0xF) << 4) | (data[1] >> 8);
+			lich[2] = data[1] & 0xFF;
+			lich[3] = data[2] >> 4;
+			lich[4] = ((data[2] & 0xF) << 4) | (data[3] >> 8);
+			lich[5] = data[3] & 0xFF;
+			*lich_cnt = lich[5] >> 5;
+
+			return ((float)dist / 0xFFFF <= LICH_MAX_DIST) && (*lich_cnt < 6);
+		}
+
+		// FN stage: does the frame number fit the stream being received?
+		bool m17_decoder_impl::fn_plausible(uint16_t fn)
+		{
+			if (!_stream_active || (fn & 0x7FFF) == 0) // new stream
+				return true;
+			if (_signed_str && (fn & 0x7FFF) >= 0x7FFC) // signature
+				return true;
+
+			return ((fn - _expected_next_fn) & 0x7FFF) < FN_MAX_SKIP;
+		}
+
+		// candidate rejected before being fully processed
+		int m17_decoder_impl::reject_hypothesis(uint8_t idx, char *out)
+		{
+			if (!_locked)
+			{
+				_false_syncs++;
+				drop_hypothesis(idx);
+				return 0;
+			}
+
+			// coasting through a fade: keep the output timing with an erased frame
+			memset(out, 0, 16);
+			_frame_info.fn = _expected_next_fn;
+			_frame_info.lich_cnt = (_lich_cnt + 1) % 6;
+			_frame_info.metric = -1;
+			_frame_info.erased = true;
+			finish_hypothesis(idx, false, false);
+			return 16;
+		}
+
+		// arm the flywheel and clear the candidates once a frame is done
+		void m17_decoder_impl::finish_hypothesis(uint8_t idx, bool frame_ok, bool last_frame)
+		{
+			// the next syncword is due right after this payload
+			if (_fw_max_misses > 0 && (frame_ok || _locked) && !last_frame)
+			{
+				if (!_locked && _debug_ctrl == true)
+					printf("Flywheel: locked\n");
+				_locked = true;
+				memcpy(_fw_buf, &_hyp[idx].pld[SYM_PER_PLD - FLYWHEEL_WIN], FLYWHEEL_WIN * sizeof(float));
+				_fw_pushed = FLYWHEEL_WIN;
+			}
+			else
+			{
+				if (_locked)
+					_correlator.reset();
+				_locked = false;
+				_fw_misses = 0;
+			}
+
+			if (frame_ok)
+			{
+				_sq_hang = _sq_hang_len;
+				_sq_probe = false; // the floor may have been learned on this stream
+			}
+
+			// all other candidates started inside this frame
+			_n_hyp = 0;
+		}
+
+		// decode a complete candidate into the output port of its stream,
+		// port 0 if that one is not connected (PDUs just carry the port number)
+		void m17_decoder_impl::complete_to_port(uint8_t idx, gr_vector_void_star &output_items, int *countout)
+		{
+			char frame[16];
+			int written = complete_hypothesis(idx, frame);
+			int port = (_stream_port > 0) ? _stream_port : 0;
+			if (_output_mode != OUTPUT_PDU && port >= (int)output_items.size())
+				port = 0;
+
+			if (written > 0)
+				output_frame(frame, port, output_items, countout);
+		}
+
+		// one 16-byte payload, described by _frame_info, in the current output mode
+		void m17_decoder_impl::output_frame(const char *frame, int port, gr_vector_void_star &output_items, int *countout)
+		{
+			if (_output_mode == OUTPUT_PDU)
+			{
+				pmt::pmt_t meta = pmt::make_dict();
+				meta = pmt::dict_add(meta, _pmt_fn, pmt::from_long(_frame_info.fn));
+				meta = pmt::dict_add(meta, _pmt_lich_cnt, pmt::from_long(_frame_info.lich_cnt));
+				meta = pmt::dict_add(meta, _pmt_metric, pmt::from_float(_frame_info.metric));
+				meta = pmt::dict_add(meta, _pmt_erasure, pmt::from_bool(_frame_info.erased));
+				meta = pmt::dict_add(meta, _pmt_output, pmt::from_long(port));
+
+				message_port_pub(_pmt_pdu, pmt::cons(meta, pmt::init_u8vector(16, (const uint8_t *)frame)));
+				return;
+			}
+
+			if (output_items.empty()) // byte output not connected
+				return;
+
+			if (_output_mode == OUTPUT_TAGGED)
+			{
+				const uint64_t offset = nitems_written(port) + countout[port];
+				add_item_tag(port, offset, _pmt_packet_len, pmt::from_long(16));
+				add_item_tag(port, offset, _pmt_fn, pmt::from_long(_frame_info.fn));
+				add_item_tag(port, offset, _pmt_lich_cnt, pmt::from_long(_frame_info.lich_cnt));
+				add_item_tag(port, offset, _pmt_metric, pmt::from_float(_frame_info.metric));
+				add_item_tag(port, offset, _pmt_erasure, pmt::from_bool(_frame_info.erased));
+			}
+
+			memcpy((char *)output_items[port] + countout[port], frame, 16);
+			countout[port] += 16;
+		}
+
+		// the output port of the current LSF, -1 to skip its stream
+		void m17_decoder_impl::apply_filter()
+		{
+			int port = _filter.route(&_lsf);
+
+			if (port != _stream_port && _debug_ctrl == true)
+			{
+				if (port < 0)
+					printf("Stream filtered out\n");
+				else
+					printf("Stream accepted, output %d\n", port);
+			}
+			_stream_port = port;
+
+			if (port < 0 && _fields_active)
+				publish_fields(_pmt_end, &_fields_lsf);
+		}
+
+		// interned callsign symbol, decoded and interned only once per callsign
+		pmt::pmt_t m17_decoder_impl::callsign_symbol(const uint8_t call[6])
+		{
+			uint64_t id = 1ULL << 63; // 0 - free entry
+			for (uint8_t i = 0; i < 6; i++)
+				id |= (uint64_t)call[i] << (8 * i);
+
+			for (uint8_t i = 0; i < CALLSIGN_CACHE; i++)
+				if (_callsigns[i].id == id)
+					return _callsigns[i].sym;
+
+			uint8_t str[12];
+			decode_callsign_bytes(str, call);
+
+			_callsigns[_callsigns_next].id = id;
+			_callsigns[_callsigns_next].sym = pmt::intern((char *)str);
+			pmt::pmt_t sym = _callsigns[_callsigns_next].sym;
+			_callsigns_next = (_callsigns_next + 1) % CALLSIGN_CACHE;
+			return sym;
+		}
+
+		// "fields" message: the LSF of a stream when it starts, changes or ends
+		void m17_decoder_impl::publish_fields(const pmt::pmt_t &event, const lsf_t *lsf)
+		{
+			pmt::pmt_t dict = pmt::make_dict();
+			dict = pmt::dict_add(dict, _pmt_event, event);
+			dict = pmt::dict_add(dict, _pmt_src, callsign_symbol(lsf->src));
+			dict = pmt::dict_add(dict, _pmt_dst, callsign_symbol(lsf->dst));
+			dict = pmt::dict_add(dict, _pmt_type, pmt::init_u8vector(2, lsf->type));
+			dict = pmt::dict_add(dict, _pmt_meta, pmt::init_u8vector(14, lsf->meta));
+
+			message_port_pub(_pmt_fields, dict);
+
+			_fields_lsf = *lsf;
+			_fields_active = !pmt::eq(event, _pmt_end);
+		}
+
+		// decode a complete candidate, returns the number of bytes written to out
+		int m17_decoder_impl::complete_hypothesis(uint8_t idx, char *out)
+		{
+			hypothesis_t *hyp = &_hyp[idx];
+			bool last_frame = false; // EoT bit set in FN
+			bool frame_ok;
+			int written = 0;
+			uint32_t e;
+
+			// the payload was normalized with this syncword fit
+			if (_normalize && hyp->scale > NORM_MIN_SCALE)
+			{
+				_norm_scale = hyp->scale;
+				_norm_dc = hyp->dc;
+			}
+
+			if (!hyp->fl) // if it is a frame
+			{
+				uint8_t frame_data[19], lich_b[6], lich_cnt;
+				uint16_t fn;
+
+				// stage 1: LICH - cheap, rejects most false triggers before the Viterbi
+				// (when locked the timing is known, the payload may still be good)
+				const uint16_t *lich_soft = hyp->d_soft_bit;
+				uint16_t lich16[96];
+				if (_soft8) // libm17's Golay decoder takes 16-bit soft bits
+				{
+					for (uint8_t i = 0; i < 96; i++)
+						lich16[i] = hyp->d_soft_bit8[i] * 0x101;
+					lich_soft = lich16;
+				}
+
+				const bool lich_ok = decode_lich(lich_b, &lich_cnt, lich_soft);
+				if (!lich_ok && !_locked)
+				{
+					_rejects_lich++;
+					if (_debug_ctrl == true)
+						printf("Sync candidate rejected: LICH\n");
+					return reject_hypothesis(idx, out);
+				}
+
+				// filtered out stream: no payload decoding, only the LICH is
+				// followed, in case it carries the LSF of a wanted stream
+				if (_stream_port < 0)
+				{
+					if (lich_ok)
+					{
+						if (lich_cnt == 0)
+							lich_chunks_rcvd = 0;
+						lich_chunks_rcvd |= (1 << lich_cnt);
+						memcpy((uint8_t *)&_lsf + lich_cnt * 5, lich_b, 5);
+						if (lich_chunks_rcvd == 0x3F && lsf_crc_ok(&_lsf))
+							apply_filter();
 					}
+					_frames_filtered++;
+					_stream_active = false; // FN not tracked, restart if the stream gets accepted
+					finish_hypothesis(idx, lich_ok, false);
+					return 0;
 				}
+
+				// stage 2: payload Viterbi
+				if (_soft8)
+					e = _viterbi.decode_punctured(frame_data, &hyp->d_soft_bit8[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2));
 				else
+					e = _viterbi.decode_punctured(frame_data, &hyp->d_soft_bit[96], puncture_pattern_2, 272, sizeof(puncture_pattern_2));
+				fn = ((uint16_t)frame_data[1] << 8) | frame_data[2];
+				frame_ok = ((float)e / 0xFFFF <= _vt_threshold);
+
+				if (!frame_ok)
 				{
-					_pld[pushed++] = sample;
+					_rejects_viterbi++;
+					if (!_locked)
+						_false_syncs++;
 
-					if (pushed == SYM_PER_PLD)
+					if (_n_hyp > 1)
 					{
-						// if it is a frame
-						if (!fl)
-						{
-							// decode
-							uint32_t e = decode_str_frame(_frame_data, _lich_b, &_fn, &_lich_cnt, _pld);
+						// most likely a false trigger, a better candidate is still pending
+						if (_debug_ctrl == true)
+							printf("Sync candidate dropped e=%1.1f\n", (float)e / 0xFFFF);
+						drop_hypothesis(idx);
+						return 0;
+					}
+				}
+				// stage 3: frame number
+				else if (!fn_plausible(fn))
+				{
+					_rejects_fn++;
+					if (_debug_ctrl == true)
+						printf("Sync candidate rejected: FN %04X\n", fn);
+					return reject_hypothesis(idx, out);
+				}
 
-							uint16_t type = ((uint16_t)_lsf.type[0] << 8) + _lsf.type[1];
-							_signed_str = (type >> 11) & 1;
+				memcpy(_frame_data, &frame_data[3], 16);
+				memcpy(_lich_b, lich_b, 6);
+				_fn = fn;
+				_lich_cnt = lich_ok ? lich_cnt : (_lich_cnt + 1) % 6; // a bad LICH counts as the expected chunk
+				last_frame = frame_ok && (_fn & 0x8000);
 
-							/// if the stream is signed (process before decryption)
-							if (_signed_str && _fn < 0x7FFC)
-							{
-								if (_fn == 0)
-									memset(_digest, 0, sizeof(_digest));
-
-								for (uint8_t i = 0; i < sizeof(_digest); i++)
-									_digest[i] ^= _frame_data[i];
-								uint8_t tmp = _digest[0];
-								for (uint8_t i = 0; i < sizeof(_digest) - 1; i++)
-									_digest[i] = _digest[i + 1];
-								_digest[sizeof(_digest) - 1] = tmp;
-							}
+				written = process_stream_frame(e, out, lich_ok);
 
-							// NOTE: Don't attempt decryption when a signed stream is >= 0x7FFC
-							// The Signature is not encrypted
+				if (frame_ok)
+				{
+					_stream_active = !last_frame;
+					_since_frame = 0;
+					if (last_frame && _fields_active)
+						publish_fields(_pmt_end, &_fields_lsf);
+				}
+			}
+			else // lsf
+			{
+				lsf_t lsf;
+				uint8_t lsf_b[31];
 
-							// AES
-							if (_encr_type == ENCR_AES)
-							{
-								memcpy(_iv, _lsf.meta, 14);
-								_iv[14] = (_fn >> 8) & 0x7F; // TODO: check if this is the right byte order
-								_iv[15] = (_fn & 0xFF) & 0xFF;
-
-								if (_signed_str && (_fn % 0x8000) < 0x7FFC) // signed stream
-									aes_ctr_bytewise_payload_crypt(_iv, _key, _frame_data, _aes_subtype);
-								else if (!_signed_str) // non-signed stream
-									aes_ctr_bytewise_payload_crypt(_iv, _key, _frame_data, _aes_subtype);
-							}
+				// the first byte only holds the flushing bits
+				if (_soft8)
+					e = _viterbi.decode_punctured(lsf_b, hyp->d_soft_bit8, puncture_pattern_1, 2 * SYM_PER_PLD, sizeof(puncture_pattern_1));
+				else
+					e = _viterbi.decode_punctured(lsf_b, hyp->d_soft_bit, puncture_pattern_1, 2 * SYM_PER_PLD, sizeof(puncture_pattern_1));
+				memcpy(&lsf, &lsf_b[1], sizeof(lsf));
+				frame_ok = ((float)e / 0xFFFF <= _vt_threshold);
 
-							// Scrambler
-							if (_encr_type == ENCR_SCRAM)
-							{
-								if (_fn != 0 && (_fn % 0x8000) != _expected_next_fn) // frame skip, etc
-									_scrambler_seed = scrambler_seed_calculation(_scrambler_subtype, _scrambler_key, _fn & 0x7FFF);
-								else if (_fn == 0)
-									_scrambler_seed = _scrambler_key; // reset back to key value
-
-								if (_signed_str && (_fn % 0x8000) < 0x7FFC) // signed stream
-									scrambler_sequence_generator();
-								else if (!_signed_str) // non-signed stream
-									scrambler_sequence_generator();
-								else
-									memset(_scr_bytes, 0, sizeof(_scr_bytes)); // zero out stale scrambler bytes so they aren't applied to the sig frames
-
-								for (uint8_t i = 0; i < 16; i++)
-								{
-									_frame_data[i] ^= _scr_bytes[i];
-								}
-							}
+				if (!frame_ok)
+				{
+					_rejects_viterbi++;
+					if (!_locked)
+						_false_syncs++;
 
-							// dump data
-							if (_debug_data == true)
-							{
-								printf("RX FN: %04X PLD: ", _fn);
+					if (_n_hyp > 1)
+					{
+						if (_debug_ctrl == true)
+							printf("Sync candidate dropped e=%1.1f\n", (float)e / 0xFFFF);
+						drop_hypothesis(idx);
+						return 0;
+					}
+				}
 
-								for (uint8_t i = 0; i < 16; i++)
-								{
-									printf("%02X", _frame_data[i]);
-								}
+				_lsf = lsf;
+				process_lsf(e);
 
-								printf(" e=%1.1f\n", (float)e / 0xFFFF);
-							}
+				// a new stream starts; the Viterbi metric can be good on a
+				// corrupted LSF, its contents are only used when the CRC checks out
+				if (frame_ok && lsf_crc_ok(&_lsf))
+				{
+					_stream_active = false;
+					_since_frame = 0;
+					if (_fields_active) // the previous one ended without EoT
+						publish_fields(_pmt_end, &_fields_lsf);
+					apply_filter();
+					_keyring.start(&_lsf);
+					if (_stream_port >= 0)
+						publish_fields(_pmt_start, &_lsf);
+				}
+			}
 
-							// set a threshold on the Viterbi metric to prevent sound artifacts
-							if ((float)e / 0xFFFF <= _vt_threshold)
-								memcpy(&out[countout], _frame_data, 16);
-							else
-								memset(&out[countout], 0, 16);
-							countout += 16;
+			finish_hypothesis(idx, frame_ok, last_frame);
 
-							// send codec2 stream to stdout
-							// fwrite(_frame_data, 16, 1, stdout);
+			return written;
+		}
 
-							// If we're at the start of a superframe, or we missed a frame, reset the LICH state
-							if ((_lich_cnt == 0) || ((_fn % 0x8000) != _expected_next_fn && _fn < 0x7FFC))
-								lich_chunks_rcvd = 0;
+		// cheap carrier detection for idle channels, consumes symbols until the squelch opens
+		int m17_decoder_impl::squelch(const float *in, int n)
+		{
+			for (int i = 0; i < n; i++)
+			{
+				_sq_sum += in[i];
+				_sq_sum2 += in[i] * in[i];
+				_sq_alt += (_sq_cnt & 1) ? -in[i] : in[i];
+
+				if (++_sq_cnt < SQ_BLOCK)
+					continue;
+
+				float ms = _sq_sum2 / SQ_BLOCK;
+				float mean = _sq_sum / SQ_BLOCK;
+				float var = ms - mean * mean;
+				float alt = _sq_alt / SQ_BLOCK;
+				_sq_cnt = 0;
+				_sq_sum = _sq_sum2 = _sq_alt = 0;
+
+				// the preamble is a +3/-3 alternating pattern, noise spreads its
+				// power evenly and leaves only ~1/SQ_BLOCK in the alternating part
+				bool preamble = (alt * alt > SQ_PREAMBLE * ms) && (ms > 0);
+				// either way: at the output of an FM discriminator a carrier lowers the
+				// variance of the noise
+				bool change = (_sq_floor > 0) && (var > SQ_CHANGE * _sq_floor || var * SQ_CHANGE < _sq_floor);
+				// the floor may have been learned on a stream already going on: the
+				// syncwords are searched for now and then, the detector cannot see it
+				bool probe = (++_sq_blocks >= SQ_PROBE_BLOCKS);
+
+				if (preamble || change || probe)
+				{
+					if (_debug_ctrl == true)
+						printf("Squelch: open (%s)\n", preamble ? "preamble" : change ? "level" : "probe");
+					_sq_open = true;
+					_sq_probe = !preamble && !change;
+					_sq_hang = _sq_probe ? std::min(_sq_hang_len, SQ_PROBE_LEN) : _sq_hang_len;
+					_sq_blocks = 0;
+					_correlator.reset();
+					return i + 1;
+				}
+
+				if (_sq_floor == 0)
+					_sq_floor = var;
+				else
+					_sq_floor += (var - _sq_floor) / SQ_FLOOR_BLOCKS;
+			}
 
-							lich_chunks_rcvd |= (1 << _lich_cnt);
-							memcpy((uint8_t *)&_lsf + _lich_cnt * 5, _lich_b, 5);
+			return n;
+		}
 
-							// debug - dump LICH
-							if (lich_chunks_rcvd == 0x3F) // all 6 chunks received?
-							{
-								// handle message output
-								pmt::pmt_t msg;
-								decode_callsign_bytes(d_dst, _lsf.dst);
-								decode_callsign_bytes(d_src, _lsf.src);
-
-								pmt::pmt_t dict = pmt::make_dict();
-								dict = pmt::dict_add(dict, pmt::mp("src"), pmt::intern((char *)d_src));
-								dict = pmt::dict_add(dict, pmt::mp("dst"), pmt::intern((char *)d_dst));
-
-								msg = pmt::init_u8vector(2, _lsf.type);
-								dict = pmt::dict_add(dict, pmt::mp("type"), msg);
-								msg = pmt::init_u8vector(14, _lsf.meta);
-								dict = pmt::dict_add(dict, pmt::mp("meta"), msg);
-
-								message_port_pub(pmt::mp("fields"), dict);
-
-								// debug data display
-								if (_callsign == true)
-								{
-									if (_debug_ctrl == true)
-									{
-										printf("DST: %-9s ", d_dst); // DST
-										printf("SRC: %-9s ", d_src); // SRC
-									}
-								}
-								else if (_debug_ctrl == true)
-								{
-									printf("DST: "); // DST
-									for (uint8_t i = 0; i < 6; i++)
-										printf("%02X", ((uint8_t *)_lsf.dst)[i]);
-									printf(" ");
-									printf("SRC: "); // SRC
-									for (uint8_t i = 0; i < 6; i++)
-										printf("%02X", ((uint8_t *)_lsf.src)[i]);
-									printf(" ");
-								}
-
-								// TYPE
-								if (_debug_ctrl == true)
-								{
-									printf("TYPE: %04X (", type);
-									if (type && 1)
-										printf("STREAM: ");
-									else
-										printf("PACKET: "); // shouldn't happen
-									if (((type >> 1) & 3) == 1)
-										printf("DATA, ");
-									else if (((type >> 1) & 3) == 2)
-										printf("VOICE, ");
-									else if (((type >> 1) & 3) == 3)
-										printf("VOICE+DATA, ");
-									printf("ENCR: ");
-									if (((type >> 3) & 3) == 0)
-										printf("PLAIN, ");
-									else if (((type >> 3) & 3) == 1)
-									{
-										printf("SCRAM ");
-										if (((type >> 5) & 3) == 1)
-											printf("8-bit, ");
-										else if (((type >> 5) & 3) == 2)
-											printf("16-bit, ");
-										else if (((type >> 5) & 3) == 3)
-											printf("24-bit, ");
-									}
-									else if (((type >> 3) & 3) == 2)
-										printf("AES, ");
-									else
-										printf("UNK, ");
-									printf("CAN: %d", (type >> 7) & 0xF);
-									if ((type >> 11) & 1)
-										printf(", SIGNED");
-									printf(") ");
-								}
-
-								// META
-								if (_debug_ctrl == true)
-								{
-									printf("META: ");
-									for (uint8_t i = 0; i < 14; i++)
-										printf("%02X", ((uint8_t *)_lsf.meta)[i]);
-
-									if (CRC_M17((uint8_t *)&_lsf, sizeof(_lsf))) // CRC
-										printf(" LSF_CRC_ERR");
-									else
-										printf(" LSF_CRC_OK ");
-									printf("\n");
-								}
-							}
+		uint64_t m17_decoder_impl::rejects_lich()
+		{
+			return _rejects_lich;
+		}
 
-							// if the contents of the payload is now digital signature, not data/voice
-							if (_fn >= 0x7FFC && _signed_str == true)
+		uint64_t m17_decoder_impl::rejects_viterbi()
+		{
+			return _rejects_viterbi;
+		}
+
+		uint64_t m17_decoder_impl::rejects_fn()
+		{
+			return _rejects_fn;
+		}
+
+		// len more symbols since the last good stream frame, counted before a frame
+		// completes: a stream not heard from for a few superframes is over, its FN
+		// is still tracked across a longer fade
+		void m17_decoder_impl::count_symbols(int len)
+		{
+			_since_frame += len;
+			if (_fields_active && _since_frame > FIELDS_END_SUPERFRAMES * 6 * SYM_PER_FRA)
+				publish_fields(_pmt_end, &_fields_lsf);
+			if (_since_frame > FN_MAX_SKIP * SYM_PER_FRA)
+				_stream_active = false;
+		}
+
+		// run n symbols through the flywheel, the candidates and the syncword search
+		void m17_decoder_impl::process_symbols(const float *in, int n, gr_vector_void_star &output_items, int *countout)
+		{
+			int counterin = 0;
+
+			while (counterin < n)
+			{
+				if (_locked && _n_hyp == 0) // wait for the expected syncword
+				{
+					const int fw_len = SYM_PER_SWD + 2 * FLYWHEEL_WIN;
+					int len = std::min(fw_len - (int)_fw_pushed, n - counterin);
+					memcpy(&_fw_buf[_fw_pushed], &in[counterin], len * sizeof(float));
+					_fw_pushed += len;
+					counterin += len;
+					count_symbols(len);
+
+					if (_fw_pushed == fw_len)
+					{
+						// best match within FLYWHEEL_WIN symbols of the predicted position
+						int best = FLYWHEEL_WIN;
+						float best_dist = _correlator.distance(&_fw_buf[FLYWHEEL_WIN], sync_correlator::SYNC_STR);
+						for (int i = 0; i <= 2 * FLYWHEEL_WIN; i++)
+						{
+							float dist = _correlator.distance(&_fw_buf[i], sync_correlator::SYNC_STR);
+							if (dist < best_dist)
 							{
-								memcpy(&_sig[((_fn & 0x7FFF) - 0x7FFC) * 16], _frame_data, 16);
-
-								if (_fn == (0x7FFF | 0x8000))
-								{
-									// dump data
-									/*printf("DEC-Digest: ");
-									   for(uint8_t i=0; i<sizeof(digest); i++)
-									   printf("%02X", digest[i]);
-									   printf("\n");
-
-									   printf("Key: ");
-									   for(uint8_t i=0; i<sizeof(pub_key); i++)
-									   printf("%02X", pub_key[i]);
-									   printf("\n");
-
-									   printf("Signature: ");
-									   for(uint8_t i=0; i<sizeof(sig); i++)
-									   printf("%02X", sig[i]);
-									   printf("\n"); */
-
-									if (uECC_verify(_key, _digest, sizeof(_digest), _sig, _curve))
-									{
-										if (_debug_ctrl == true)
-											printf("Signature OK\n");
-									}
-									else
-									{
-										if (_debug_ctrl == true)
-											printf("Signature invalid\n");
-									}
-								}
+								best_dist = dist;
+								best = i;
 							}
+						}
 
-							_expected_next_fn = (_fn + 1) % 0x8000;
+						if (best_dist < _correlator.threshold())
+						{
+							_fw_misses = 0;
+							_correlator.fit(&_fw_buf[best], sync_correlator::SYNC_STR, &_norm_scale, &_norm_dc);
 						}
-						else // lsf
+						else // fade - coast through at the predicted position, keep the last fit
 						{
-							if (_debug_ctrl == true)
-							{
-								printf("{LSF} ");
-							}
-							// decode
-							uint32_t e = decode_LSF(&_lsf, _pld);
+							best = FLYWHEEL_WIN;
+							_fw_misses++;
+						}
 
-							// dump data
-							if (_callsign == true)
-							{
-								decode_callsign_bytes(d_dst, _lsf.dst);
-								decode_callsign_bytes(d_src, _lsf.src);
-								if (_debug_ctrl == true)
-								{
-									printf("DST: %-9s ", d_dst); // DST
-									printf("SRC: %-9s ", d_src); // SRC
-								}
-							}
-							else
-							{
-								if (_debug_ctrl == true)
-								{
-									printf("DST: "); // DST
-									for (uint8_t i = 0; i < 6; i++)
-										printf("%02X", ((uint8_t *)_lsf.dst)[i]);
-									printf(" ");
-
-									// SRC
-									printf("SRC: ");
-									for (uint8_t i = 0; i < 6; i++)
-										printf("%02X", ((uint8_t *)_lsf.src)[i]);
-									printf(" ");
-								}
-							}
-							// TYPE
-							uint16_t type = ((uint16_t)_lsf.type[0] << 8) + _lsf.type[1];
+						if (_fw_misses > _fw_max_misses)
+						{
 							if (_debug_ctrl == true)
-							{
-								printf("TYPE: %04X (", type);
-								if (type && 1)
-									printf("STREAM: ");
-								else
-									printf("PACKET: "); // shouldn't happen
-								if (((type >> 1) & 3) == 1)
-									printf("DATA, ");
-								else if (((type >> 1) & 3) == 2)
-									printf("VOICE, ");
-								else if (((type >> 1) & 3) == 3)
-									printf("VOICE+DATA, ");
-								printf("ENCR: ");
-								if (((type >> 3) & 3) == 0)
-									printf("PLAIN, ");
-								else if (((type >> 3) & 3) == 1)
-								{
-									printf("SCRAM ");
-									if (((type >> 5) & 3) == 0)
-										printf("8-bit, ");
-									else if (((type >> 5) & 3) == 1)
-										printf("16-bit, ");
-									else if (((type >> 5) & 3) == 2)
-										printf("24-bit, ");
-								}
-								else if (((type >> 3) & 3) == 2)
-								{
-									printf("AES");
-									if (((type >> 5) & 3) == 0)
-										printf("128");
-									else if (((type >> 5) & 3) == 1)
-										printf("192");
-									else if (((type >> 5) & 3) == 2)
-										printf("256");
-
-									printf(", ");
-								}
-								else
-									printf("UNK, ");
-								printf("CAN: %d", (type >> 7) & 0xF);
-								if ((type >> 11) & 1)
-								{
-									printf(", SIGNED");
-									_signed_str = 1;
-								}
-								else
-									_signed_str = 0;
-								printf(") ");
-
-								// META
-								printf("META: ");
-								for (uint8_t i = 0; i < 14; i++)
-									printf("%02X", ((uint8_t *)_lsf.meta)[i]);
-								printf(" ");
-								// CRC
-								// printf("CRC: ");
-								// for(uint8_t i=0; i<2; i++)
-								// printf("%02X", lsf[28+i]);
-								if (CRC_M17((uint8_t *)&_lsf, 30))
-									printf("LSF_CRC_ERR");
-								else
-									printf("LSF_CRC_OK ");
-								// Viterbi decoder errors
-								printf(" e=%1.1f\n", (float)e / 0xFFFF);
-							}
+								printf("Flywheel: lock lost\n");
+							_locked = false;
+							_fw_misses = 0;
+							_correlator.reset();
+
+							// the window may hold the syncword of another stream: back to the search
+							float rescan[fw_len];
+							memcpy(rescan, _fw_buf, sizeof(rescan));
+							_fw_pushed = 0;
+							_since_frame -= std::min(_since_frame, (uint64_t)fw_len); // counted again
+							process_symbols(rescan, fw_len, output_items, countout);
+							continue;
+						}
+						else
+						{
+							// symbols after the syncword already belong to the payload
+							_hyp[0].fl = 0;
+							_hyp[0].dist = best_dist;
+							_hyp[0].scale = _norm_scale;
+							_hyp[0].dc = _norm_dc;
+							_hyp[0].pushed = 0;
+							push_symbols(0, &_fw_buf[best + SYM_PER_SWD], fw_len - (best + SYM_PER_SWD));
+							_n_hyp = 1;
 						}
-						// job done
-						syncd = 0;
-						pushed = 0;
+						_fw_pushed = 0;
+					}
+				}
+				else if (_locked) // single candidate at the predicted position
+				{
+					int len = std::min(SYM_PER_PLD - (int)_hyp[0].pushed, n - counterin);
+					push_symbols(0, &in[counterin], len);
+					counterin += len;
+					count_symbols(len);
+
+					if (_hyp[0].pushed == SYM_PER_PLD)
+						complete_to_port(0, output_items, countout);
+				}
+				else if (_sq_hang_len > 0 && !_sq_open && _n_hyp == 0) // idle channel
+				{
+					int len = squelch(&in[counterin], n - counterin);
+					counterin += len;
+					count_symbols(len);
+				}
+				else
+				{
+					// scan the rest of the buffer for syncwords in one pass
+					_hits.clear();
+					_correlator.scan(&in[counterin], n - counterin, _hits);
+					int base = counterin;
+					size_t h = 0;
+
+					// every candidate keeps collecting symbols while the search goes on,
+					// so a false trigger cannot hide a real syncword
+					while (counterin < n && !_locked)
+					{
+						int next = n;
+						if (h < _hits.size())
+							next = std::min(next, base + _hits[h].offset + 1);
+						for (uint8_t i = 0; i < _n_hyp; i++)
+							next = std::min(next, counterin + SYM_PER_PLD - _hyp[i].pushed);
+
+						for (uint8_t i = 0; i < _n_hyp; i++)
+							push_symbols(i, &in[counterin], next - counterin);
+						count_symbols(next - counterin);
+						_sq_hang -= std::min(_sq_hang, next - counterin); // a good frame below resets it
+						counterin = next;
+
+						// the oldest candidate is always the first one to complete
+						if (_n_hyp > 0 && _hyp[0].pushed == SYM_PER_PLD)
+							complete_to_port(0, output_items, countout);
+
+						while (!_locked && h < _hits.size() && base + _hits[h].offset + 1 == counterin)
+							spawn_hypothesis(_hits[h++]);
+					}
 
-						for (uint8_t i = 0; i < 8; i++)
-							last[i] = 0.0;
+					// nothing decoded for the hang time
+					if (_sq_hang_len > 0 && !_locked && _sq_hang <= 0 && _n_hyp == 0)
+					{
+						if (_debug_ctrl == true)
+							printf("Squelch: closed\n");
+						_sq_open = false;
+						if (!_sq_probe)
+							_sq_floor = 0; // re-learn, the channel may carry something else
 					}
 				}
 			}
+		}
+
+		int
+		m17_decoder_impl::general_work(int noutput_items,
+									   gr_vector_int &ninput_items,
+									   gr_vector_const_void_star &input_items,
+									   gr_vector_void_star &output_items)
+		{
+			gr::thread::scoped_lock lock(d_setlock); // the setters run in other threads
+			int countout[FILTER_MAX_PORTS] = {0};
+			int n = ninput_items[0];
+
+			if (_symbol_input)
+				process_symbols((const float *)input_items[0], n, output_items, countout);
+			else
+			{
+				// everything below works on symbols. While the squelch keeps the decoder
+				// idle, the front end does not look for syncwords, and gets the input in
+				// blocks short enough for the squelch to open during a preamble
+				const char *in = (const char *)input_items[0];
+				n = 0;
+				for (int done = 0; done < ninput_items[0];)
+				{
+					const bool idle = _sq_hang_len > 0 && !_sq_open && !_locked && _n_hyp == 0;
+					int len = ninput_items[0] - done;
+					if (idle)
+						len = std::min(len, SQ_BLOCK * _frontend.sps());
+
+					_frontend.set_search(!idle);
+					// the adaptive threshold, but a false hit moves the sampling phase of
+					// everything after it: never looser than the fixed one
+					_frontend.set_threshold(std::min(_correlator.threshold(), _sw_threshold));
+					_symbols.clear();
+					int ns = _frontend.process(in + done * _item_size, len, _symbols);
+					process_symbols(_symbols.data(), ns, output_items, countout);
+					done += len;
+					n += ns;
+				}
+			}
+
+			// false syncs per second at 4800 symbols/s, averaged over ~10 seconds
+			if (n > 0)
+			{
+				float a = std::min((float)n / (10 * 4800), 1.0f);
+				_false_sync_rate += a * ((float)_false_syncs * 4800 / n - _false_sync_rate);
+				_false_syncs = 0;
+			}
+
 			// Tell runtime system how many input items we consumed on
 			// each input stream.
 			consume_each(ninput_items[0]);
 
-			// Tell runtime system how many output items we produced.
-			return countout;
+			// Tell runtime system how many output items we produced on each port.
+			for (size_t p = 0; p < output_items.size(); p++)
+				produce(p, countout[p]);
+			return WORK_CALLED_PRODUCE;
 		}
 
 	} /* namespace m17 */
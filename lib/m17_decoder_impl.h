@@ -9,7 +9,19 @@
 #define INCLUDED_M17_M17_DECODER_IMPL_H
 
 #include <gnuradio/m17/m17_decoder.h>
+#include <vector>
 #include "m17.h"
+#include "golay_decoder.h"
+#include "key_store.h"
+#include "keyring.h"
+#include "aes_engine.h"
+#include "m17_tables.h"
+#include "scrambler.h"
+#include "signature_verifier.h"
+#include "stream_filter.h"
+#include "sync_correlator.h"
+#include "symbol_frontend.h"
+#include "viterbi_decoder.h"
 
 #define AES
 #define ECC
@@ -52,13 +64,78 @@ namespace gr
 	AES192,
 	AES256
       } aes_t;
-      int8_t _aes_subtype = -1;
+      int8_t _aes_subtype = -1;	//from the LSF TYPE field
+      aes_engine _aes;		//key schedule of _key and _aes_subtype
 #endif
+      stream_filter _filter;
+      int _stream_port = 0;	//output port of the current stream, -1 - filtered out
+      uint64_t _frames_filtered = 0;	//stream frames not decoded because of the filter
+      keyring _keyring;		//per talk group keys, used instead of _key and the seed when one matches
 
-      float last[8] = { 0 };	//look-back buffer for finding syncwords
-      float _pld[SYM_PER_PLD];	//raw frame symbols
-      uint16_t soft_bit[2 * SYM_PER_PLD];	//raw frame soft bits
-      uint16_t d_soft_bit[2 * SYM_PER_PLD];	//deinterleaved soft bits
+      symbol_frontend _frontend;	//input conversion to symbols
+      bool _symbol_input;	//float symbols, no front end needed
+      size_t _item_size;	//bytes per input item
+      std::vector < float >_symbols;	//front end output
+      sync_correlator _correlator;	//block-wise syncword search
+      std::vector < sync_correlator::hit_t > _hits;	//syncword candidates in the current buffer
+      float _pfa = 0;		//target false sync probability per symbol (0 - fixed threshold)
+      int _false_syncs = 0;	//candidates that did not decode, in the current work call
+      float _false_sync_rate = 0;	//false syncs per second (at 4800 symbols/s)
+//Staged frame validation, cheapest checks first
+#define LICH_MAX_DIST 24.0	//max soft distance between the LICH and its Golay codewords, in bits (of 96)
+#define FN_MAX_SKIP 250		//max frame number jump within a stream (10 s)
+      uint64_t _rejects_lich = 0;	//candidates rejected by the LICH check
+      uint64_t _rejects_viterbi = 0;	//candidates above the Viterbi threshold
+      uint64_t _rejects_fn = 0;	//candidates with an implausible FN
+      bool _stream_active = false;	//stream frames received, _expected_next_fn is valid
+      uint64_t _since_frame = 0;	//symbols since the last good stream frame
+//Flywheel: once locked, only look for the next syncword around its expected position
+#define FLYWHEEL_WIN 2		//symbols of timing slack on each side
+      bool _locked = false;	//tracking a stream, full search disabled
+      int _fw_max_misses = 0;	//syncwords we may coast through before unlocking (0 - flywheel off)
+      int _fw_misses = 0;	//consecutive coasted syncwords
+      float _fw_buf[SYM_PER_SWD + 2 * FLYWHEEL_WIN];	//payload tail plus the expected syncword
+      uint8_t _fw_pushed = 0;	//counter for symbols in _fw_buf
+//Squelch: on an idle channel only a cheap preamble/variance detector runs
+#define SQ_BLOCK 48		//detector block length, in symbols (10 ms)
+#define SQ_PREAMBLE 0.5		//min fraction of the block power in the +3/-3 alternating preamble
+#define SQ_CHANGE 4.0		//variance change from the noise floor that opens the squelch (6 dB)
+#define SQ_FLOOR_BLOCKS 100	//noise floor averaging length, in blocks
+#define SQ_PROBE_BLOCKS 50	//blocks between two syncword searches while closed (late entry)
+#define SQ_PROBE_LEN (2 * SYM_PER_FRA)	//length of such a search, in symbols
+      int _sq_hang_len = 0;	//hang time in symbols (0 - squelch off)
+      int _sq_hang = 0;		//symbols left before the squelch closes
+      bool _sq_open = false;
+      bool _sq_probe = false;	//opened for a periodic search, not by the detector
+      int _sq_blocks = 0;	//blocks since the last search
+      float _sq_floor = 0;	//noise floor variance (0 - not measured yet)
+      int _sq_cnt = 0;		//symbols in the current block
+      float _sq_sum = 0, _sq_sum2 = 0, _sq_alt = 0;	//block sums: x, x^2, alternating x
+//Symbol normalization from the syncword
+#define NORM_MIN_SCALE 0.1	//smaller fitted scales are not trusted
+      bool _normalize = false;	//remove DC and scale the payload before slicing
+      float _norm_scale = 1.0;	//last syncword fit, used while coasting
+      float _norm_dc = 0.0;
+//Multi-hypothesis sync: every syncword candidate collects its own payload
+#define MAX_HYPOTHESES 4	//concurrent candidate frame starts
+      typedef struct
+      {
+	float pld[SYM_PER_PLD];	//raw frame symbols
+	union			//deinterleaved soft bits, filled as symbols arrive
+	{
+	  uint16_t d_soft_bit[2 * SYM_PER_PLD];
+	  uint8_t d_soft_bit8[2 * SYM_PER_PLD];	//8-bit soft bits
+	};
+	uint8_t pushed;		//counter for pushed symbols
+	uint8_t fl;		//Frame=0 of LSF=1
+	float dist;		//syncword distance
+	float scale;		//symbol scale and DC offset fitted on the syncword
+	float dc;
+      } hypothesis_t;
+      hypothesis_t _hyp[MAX_HYPOTHESES];
+      uint8_t _n_hyp = 0;	//candidates in _hyp, oldest first
+      viterbi_decoder _viterbi;	//SIMD, bit-exact with libm17
+      bool _soft8 = false;	//8-bit soft bits instead of 16-bit
       uint16_t _expected_next_fn;
       uint16_t _fn;
 
@@ -72,39 +149,114 @@ namespace gr
       uint8_t _frame_data[19];	//decoded frame data, 144 bits (16+128), plus 4 flushing bits
       uint8_t digest[16] = { 0 };
 
-      uint8_t syncd = 0;	//syncword found?
-      uint8_t fl = 0;		//Frame=0 of LSF=1
-      uint8_t pushed;		//counter for pushed symbols
 
       uint8_t d_dst[12], d_src[12];	//decoded strings
+//LSF fields messages: published when a stream starts, changes or ends
+#define CALLSIGN_CACHE 16	//interned callsigns kept
+#define FIELDS_END_SUPERFRAMES 3	//superframes (6 frames, 240 ms) without a good frame before "end"
+      bool _fields_active = false;	//stream started, end not published yet
+      lsf_t _fields_lsf;	//last published LSF
+      struct
+      {
+	uint64_t id;		//encoded callsign, bit 63 set (0 - free)
+	pmt::pmt_t sym;
+      } _callsigns[CALLSIGN_CACHE] = { };
+      uint8_t _callsigns_next = 0;	//next entry to replace
+      const pmt::pmt_t _pmt_fields = pmt::mp ("fields");
+      const pmt::pmt_t _pmt_event = pmt::mp ("event");
+      const pmt::pmt_t _pmt_start = pmt::mp ("start");
+      const pmt::pmt_t _pmt_update = pmt::mp ("update");
+      const pmt::pmt_t _pmt_end = pmt::mp ("end");
+      const pmt::pmt_t _pmt_src = pmt::mp ("src");
+      const pmt::pmt_t _pmt_dst = pmt::mp ("dst");
+      const pmt::pmt_t _pmt_type = pmt::mp ("type");
+      const pmt::pmt_t _pmt_meta = pmt::mp ("meta");
+//Payload output: byte stream, tagged stream or PDUs
+      int _output_mode = OUTPUT_STREAM;
+      typedef struct
+      {
+	uint16_t fn;
+	uint8_t lich_cnt;
+	float metric;		//Viterbi metric in bits, -1 if the frame was not decoded
+	bool erased;		//payload replaced by zeros
+      } frame_info_t;
+      frame_info_t _frame_info;	//of the last payload written
+      const pmt::pmt_t _pmt_pdu = pmt::mp ("pdu");
+      const pmt::pmt_t _pmt_packet_len = pmt::mp ("packet_len");
+      const pmt::pmt_t _pmt_fn = pmt::mp ("fn");
+      const pmt::pmt_t _pmt_lich_cnt = pmt::mp ("lich_cnt");
+      const pmt::pmt_t _pmt_metric = pmt::mp ("viterbi_metric");
+      const pmt::pmt_t _pmt_erasure = pmt::mp ("erasure");
+      const pmt::pmt_t _pmt_output = pmt::mp ("output");
 #ifdef ECC
 //Scrambler
       uint8_t _seed[3]; //24-bit is the largest seed value
       uint8_t _scr_bytes[16];
-      uint8_t _scrambler_pn[128];
       uint32_t _scrambler_seed = 0;
       int8_t _scrambler_subtype = -1;
 #endif
       const struct uECC_Curve_t *_curve = uECC_secp256r1 ();
+      key_store _pub_keys;	//per source callsign, _key for the other stations
+      signature_verifier _verifier;	//last member: its threads use the others
+
+      void signature_checked (const signature_verifier::job_t & job);
 
     public:
       m17_decoder_impl (bool debug_data, bool debug_ctrl, float sw_threshold,
 			float vt_threshold, bool callsign, bool signed_str, int encr_type,
-			std::string key, std::string seed);
+			std::string key, std::string seed, int input_type, int sps);
       ~m17_decoder_impl ();
       void set_debug_data (bool debug);
       void set_key (std::string arg);
+      void set_pub_keys (std::string keys);
+      void set_keyring (std::string keys);
+      void set_filter (std::string rules);
+      uint64_t frames_filtered ();
+      void set_output_mode (int mode);
       void set_seed (std::string seed);
       void set_debug_ctrl (bool debug);
       void set_callsign (bool callsign);
       void set_sw_threshold (float sw_threshold);
       void set_vt_threshold (float vt_threshold);
       void set_signed (bool signed_str);
+      void set_flywheel (int max_misses);
+      void set_false_alarm_rate (float pfa);
+      float sw_threshold ();
+      float false_sync_rate ();
+      void set_squelch (float hang_time);
+      void set_normalize (bool normalize);
+      void set_soft_bits (int bits);
+      bool squelch_open ();
+      uint64_t rejects_lich ();
+      uint64_t rejects_viterbi ();
+      uint64_t rejects_fn ();
       void set_encr_type (int encr_type);
       void parse_raw_key_string (uint8_t * dest, const char *inp);
       void scrambler_sequence_generator ();
       uint32_t scrambler_seed_calculation (int8_t subtype, uint32_t key,
 					   int fn);
+      void spawn_hypothesis (const sync_correlator::hit_t & hit);
+      void drop_hypothesis (uint8_t idx);
+      int complete_hypothesis (uint8_t idx, char *out);
+      void complete_to_port (uint8_t idx, gr_vector_void_star & output_items,
+			     int *countout);
+      void apply_filter ();
+      pmt::pmt_t callsign_symbol (const uint8_t call[6]);
+      void publish_fields (const pmt::pmt_t & event, const lsf_t * lsf);
+      void output_frame (const char *frame, int port,
+			 gr_vector_void_star & output_items, int *countout);
+      void push_symbols (uint8_t idx, const float *in, int len);
+      int reject_hypothesis (uint8_t idx, char *out);
+      void finish_hypothesis (uint8_t idx, bool frame_ok, bool last_frame);
+      bool decode_lich (uint8_t lich[6], uint8_t * lich_cnt,
+			const uint16_t inp[96]);
+      bool fn_plausible (uint16_t fn);
+      int squelch (const float *in, int n);
+      int process_stream_frame (uint32_t e, char *out, bool lich_ok);
+      void process_lsf (uint32_t e);
+      void process_symbols (const float *in, int n,
+			    gr_vector_void_star & output_items, int *countout);
+      void count_symbols (int len);
 
       // Where all the action really happens
       void forecast (int noutput_items,
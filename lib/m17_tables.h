@@ -0,0 +1,236 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_TABLES_H
+#define INCLUDED_M17_TABLES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Lookup tables shared by the coder and the decoder, all generated at
+ * compile time from the constants of the M17 specification (the same
+ * values as libm17's runtime tables), so that nothing is initialized at
+ * startup and no hot path walks bits one at a time.
+ */
+
+// Golay(24,12) parity rows, libm17's encode_matrix and decode_matrix
+    inline constexpr uint16_t GOLAY_ENCODE_MATRIX[12] =
+      { 0x8eb, 0x93e, 0xa97, 0xdc6, 0x367, 0x6cd, 0xd99, 0x3da, 0x7b4, 0xf68,
+      0x63b, 0xc75
+    };
+    inline constexpr uint16_t GOLAY_DECODE_MATRIX[12] =
+      { 0xc75, 0x49f, 0x93e, 0x6e3, 0xdc6, 0xf13, 0xab9, 0x1ed, 0x3da, 0x7b4,
+      0xf68, 0xa4f
+    };
+
+// randomizer sequence, libm17's rand_seq
+    inline constexpr uint8_t RAND_SEQ[SYM_PER_PLD * 2 / 8] =
+      { 0xD6, 0xB5, 0xE2, 0x30, 0x82, 0xFF, 0x84, 0x62, 0xBA, 0x4E, 0x96,
+      0x90, 0xD8, 0x98, 0xDD, 0x5D, 0x0C, 0xC8, 0x52, 0x43, 0x91, 0x1D, 0xF8,
+      0x6E, 0x68, 0x2F, 0x35, 0xDA, 0x14, 0xEA, 0xCD, 0x76, 0x19, 0x8D, 0xD5,
+      0x80, 0xD1, 0x33, 0x87, 0x13, 0x57, 0x18, 0x2D, 0x29, 0x78, 0xC3
+    };
+
+// CRC-16 (poly 0x5935, init 0xFFFF), slicing by 4:
+// crc[k][b] is the CRC of byte b followed by k zero bytes
+    struct crc_table_t
+    {
+      uint16_t crc[4][256];
+
+      constexpr crc_table_t ():crc ()
+      {
+	for (int b = 0; b < 256; b++)
+	  {
+	    uint16_t c = b << 8;
+	    for (int j = 0; j < 8; j++)
+	      c = (c & 0x8000) ? (c << 1) ^ 0x5935 : c << 1;
+	    crc[0][b] = c;
+	  }
+	for (int k = 1; k < 4; k++)
+	  for (int b = 0; b < 256; b++)
+	    crc[k][b] =
+	      (uint16_t) (crc[k - 1][b] << 8) ^ crc[0][crc[k - 1][b] >> 8];
+      }
+    };
+    inline constexpr crc_table_t CRC_TABLE {};
+
+// same value as libm17's CRC_M17()
+    inline uint16_t crc_m17 (const uint8_t * in, size_t len)
+    {
+      uint16_t c = 0xFFFF;
+      size_t i = 0;
+
+      for (; i + 4 <= len; i += 4)
+	c = CRC_TABLE.crc[3][(c >> 8) ^ in[i]] ^
+	  CRC_TABLE.crc[2][(c & 0xFF) ^ in[i + 1]] ^
+	  CRC_TABLE.crc[1][in[i + 2]] ^ CRC_TABLE.crc[0][in[i + 3]];
+      for (; i < len; i++)
+	c = (uint16_t) (c << 8) ^ CRC_TABLE.crc[0][(c >> 8) ^ in[i]];
+
+      return c;
+    }
+
+    inline uint16_t lsf_crc (const lsf_t * lsf)
+    {
+      return crc_m17 ((const uint8_t *) lsf, sizeof (lsf_t) - 2);
+    }
+
+// the LSF is intact, its CRC checks out
+    inline bool lsf_crc_ok (const lsf_t * lsf)
+    {
+      return crc_m17 ((const uint8_t *) lsf, sizeof (lsf_t)) == 0;
+    }
+
+    inline void update_lsf_crc (lsf_t * lsf)
+    {
+      uint16_t c = lsf_crc (lsf);
+      lsf->crc[0] = c >> 8;
+      lsf->crc[1] = c & 0xFF;
+    }
+
+// Golay(24,12) parity of the low data byte and of the high data nibble
+    struct golay_table_t
+    {
+      uint16_t lo[256];
+      uint16_t hi[16];
+
+      constexpr golay_table_t ():lo (), hi ()
+      {
+	for (int b = 0; b < 256; b++)
+	  for (int i = 0; i < 8; i++)
+	    if ((b >> i) & 1)
+	      lo[b] ^= GOLAY_ENCODE_MATRIX[i];
+	for (int n = 0; n < 16; n++)
+	  for (int i = 0; i < 4; i++)
+	    if ((n >> i) & 1)
+	      hi[n] ^= GOLAY_ENCODE_MATRIX[8 + i];
+      }
+    };
+    inline constexpr golay_table_t GOLAY_TABLE {};
+
+// same value as libm17's golay24_encode()
+    inline constexpr uint32_t golay_encode (uint16_t data)
+    {
+      return ((uint32_t) (data & 0xFFF) << 12) |
+	(GOLAY_TABLE.lo[data & 0xFF] ^ GOLAY_TABLE.hi[(data >> 8) & 0xF]);
+    }
+
+// rate 1/2, K=5 convolutional code, one input byte at a time: out[s][b] holds
+// the 16 encoded bits G1,G2,G1,G2... (MSB first) of byte b from state s (the
+// previous 4 input bits), the next state is the low nibble of b
+    struct conv_table_t
+    {
+      uint16_t out[16][256];
+
+      constexpr conv_table_t ():out ()
+      {
+	for (int s = 0; s < 16; s++)
+	  for (int b = 0; b < 256; b++)
+	    {
+	      uint32_t u = (s << 8) | b;	//input bits, oldest in bit 11
+	      uint16_t o = 0;
+	      for (int n = 0; n < 8; n++)
+		{
+		  const int p = 7 - n;	//current input bit
+		  uint8_t g1 = ((u >> p) ^ (u >> (p + 3)) ^ (u >> (p + 4))) & 1;
+		  uint8_t g2 =
+		    ((u >> p) ^ (u >> (p + 1)) ^ (u >> (p + 2)) ^
+		     (u >> (p + 4))) & 1;
+		  o = (o << 2) | (g1 << 1) | g2;
+		}
+	      out[s][b] = o;
+	    }
+      }
+    };
+    inline constexpr conv_table_t CONV_TABLE {};
+
+// QPP interleaver, libm17's intrl_seq, its own inverse
+    struct intrl_table_t
+    {
+      uint16_t seq[SYM_PER_PLD * 2];
+
+      constexpr intrl_table_t ():seq ()
+      {
+	for (uint32_t i = 0; i < SYM_PER_PLD * 2; i++)
+	  seq[i] = (45 * i + 92 * i * i) % (SYM_PER_PLD * 2);
+      }
+    };
+    inline constexpr intrl_table_t INTRL_TABLE {};
+
+// where each encoded bit of a frame goes after puncturing and interleaving,
+// -1 for the punctured ones; first the bits of the punctured part of the frame
+    template < int N, int P > struct slot_table_t
+    {
+      int16_t slot[N];
+
+      constexpr slot_table_t (const uint8_t (&punct)[P], int first):slot ()
+      {
+	int k = first;
+	for (int i = 0; i < N; i++)
+	  slot[i] = punct[i % P] ? INTRL_TABLE.seq[k++] : -1;
+      }
+    };
+
+    inline constexpr uint8_t PUNCTURE_P1[61] =
+      { 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0,
+      1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0,
+      1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1
+    };
+    inline constexpr uint8_t PUNCTURE_P2[12] =
+      { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0 };
+
+    inline constexpr slot_table_t < 2 * 244, 61 > LSF_SLOTS (PUNCTURE_P1, 0);	//240 LSF bits + 4 flush bits
+    inline constexpr slot_table_t < 2 * 148, 12 > STR_SLOTS (PUNCTURE_P2, 96);	//144 FN and payload bits + 4 flush bits, after the LICH
+
+// the 4 symbols of a byte of randomized bits, libm17's symbol_map
+    struct symbol_table_t
+    {
+      float sym[256][4];
+
+      constexpr symbol_table_t ():sym ()
+      {
+	constexpr float map[4] = { +1.0f, +3.0f, -1.0f, -3.0f };
+	for (int b = 0; b < 256; b++)
+	  for (int i = 0; i < 4; i++)
+	    sym[b][i] = map[(b >> (6 - 2 * i)) & 3];
+      }
+    };
+    inline constexpr symbol_table_t SYMBOL_TABLE {};
+
+// receive side: where the 2 soft bits of each frame symbol land once
+// derandomized and deinterleaved, and the mask that derandomizes them
+    struct soft_slot_table_t
+    {
+      struct
+      {
+	uint16_t pos[2];
+	uint16_t flip[2];
+      } sym[SYM_PER_PLD];
+
+      constexpr soft_slot_table_t ():sym ()
+      {
+	for (int j = 0; j < SYM_PER_PLD * 2; j++)
+	  {
+	    sym[j / 2].pos[j % 2] = INTRL_TABLE.seq[j];
+	    sym[j / 2].flip[j % 2] =
+	      ((RAND_SEQ[j / 8] >> (7 - (j % 8))) & 1) ? 0xFFFF : 0x0000;
+	  }
+      }
+    };
+    inline constexpr soft_slot_table_t SOFT_SLOTS {};
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_TABLES_H */
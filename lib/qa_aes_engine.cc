@@ -0,0 +1,72 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <random>
+#include "aes_engine.h"
+#include "aes.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// the counter block of a stream frame: 14 bytes of META, then the FN
+		static void stream_iv(uint8_t iv[16], const uint8_t meta[14], uint16_t fn)
+		{
+			memcpy(iv, meta, 14);
+			iv[14] = (fn >> 8) & 0x7F;
+			iv[15] = fn & 0xFF;
+		}
+
+		// the engine's keystream is the one of tinier-aes, whatever its implementation,
+		// for all three key lengths, random keys and IVs, and frame numbers across a carry
+		BOOST_AUTO_TEST_CASE(t1_ctr_crypt_matches_tinier_aes)
+		{
+			const uint16_t fn_edges[] = {0x0000, 0x00FF, 0x0100, 0x01FF, 0x7EFF, 0x7FFF, 0xFFFF};
+			std::mt19937 rng(17);
+			aes_engine aes;
+
+			for (int trial = 0; trial < 100; trial++)
+			{
+				uint8_t key[32], meta[14];
+				for (uint8_t i = 0; i < sizeof(key); i++)
+					key[i] = rng();
+				for (uint8_t i = 0; i < sizeof(meta); i++)
+					meta[i] = (trial % 10 == 0) ? 0xFF : rng(); // all ones: every byte carries
+
+				// same key, other subtype: the key schedule must follow
+				for (int8_t subtype = 0; subtype < 3; subtype++)
+				{
+					aes.set_key(key, subtype);
+
+					for (int k = 0; k < 16; k++)
+					{
+						uint16_t fn = (k < 7) ? fn_edges[k] : (uint16_t)rng();
+						uint8_t iv[16], payload[16], ref[16];
+						stream_iv(iv, meta, fn);
+						for (uint8_t i = 0; i < sizeof(payload); i++)
+							payload[i] = rng();
+						memcpy(ref, payload, sizeof(ref));
+
+						uint8_t ref_iv[16], ref_key[32];
+						memcpy(ref_iv, iv, sizeof(ref_iv));
+						memcpy(ref_key, key, sizeof(ref_key));
+						aes_ctr_bytewise_payload_crypt(ref_iv, ref_key, ref, subtype);
+
+						aes.ctr_crypt(iv, payload);
+						BOOST_CHECK_MESSAGE(memcmp(payload, ref, sizeof(ref)) == 0,
+											"subtype " << (int)subtype << " FN " << fn << " with " << aes.impl_name());
+					}
+				}
+			}
+			BOOST_TEST_MESSAGE("AES: " << aes.impl_name());
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
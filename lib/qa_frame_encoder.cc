@@ -0,0 +1,97 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <random>
+#include "m17.h"
+#include "m17_tables.h"
+#include "frame_encoder.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// a random LSF with a valid CRC
+		static lsf_t random_lsf(std::mt19937 &rng)
+		{
+			lsf_t lsf;
+			for (uint8_t i = 0; i < sizeof(lsf); i++)
+				((uint8_t *)&lsf)[i] = rng();
+			update_LSF_CRC(&lsf);
+			return lsf;
+		}
+
+		// the table-driven CRC against libm17's CRC_M17(), for all lengths up to an LSF and more
+		BOOST_AUTO_TEST_CASE(t1_crc_m17)
+		{
+			std::mt19937 rng(5);
+			uint8_t buf[64];
+
+			for (int trial = 0; trial < 20; trial++)
+			{
+				for (uint8_t i = 0; i < sizeof(buf); i++)
+					buf[i] = rng();
+				for (uint16_t len = 0; len <= sizeof(buf); len++)
+					BOOST_CHECK_EQUAL(crc_m17(buf, len), CRC_M17(buf, len));
+			}
+
+			lsf_t lsf = random_lsf(rng);
+			BOOST_CHECK_EQUAL(lsf_crc(&lsf), LSF_CRC(&lsf));
+			BOOST_CHECK(lsf_crc_ok(&lsf));
+		}
+
+		// the table-driven Golay encoder against libm17's golay24_encode(), every data word
+		BOOST_AUTO_TEST_CASE(t2_golay_encode)
+		{
+			for (uint16_t d = 0; d < 0x1000; d++)
+				BOOST_CHECK_EQUAL(golay_encode(d), golay24_encode(d));
+		}
+
+		// LSF frames, symbol for symbol the same as libm17's gen_frame()
+		BOOST_AUTO_TEST_CASE(t3_gen_frame_lsf)
+		{
+			std::mt19937 rng(7);
+
+			for (int trial = 0; trial < 50; trial++)
+			{
+				lsf_t lsf = random_lsf(rng);
+				float out[SYM_PER_FRA], ref[SYM_PER_FRA];
+
+				frame_encoder::gen_frame(out, nullptr, FRAME_LSF, &lsf, 0, 0);
+				::gen_frame(ref, nullptr, FRAME_LSF, &lsf, 0, 0);
+				BOOST_CHECK_EQUAL_COLLECTIONS(out, out + SYM_PER_FRA, ref, ref + SYM_PER_FRA);
+			}
+		}
+
+		// stream frames, every LICH_CNT, with and without the EoT bit
+		BOOST_AUTO_TEST_CASE(t4_gen_frame_stream)
+		{
+			std::mt19937 rng(11);
+
+			for (int trial = 0; trial < 50; trial++)
+			{
+				lsf_t lsf = random_lsf(rng);
+				uint8_t data[16];
+				for (uint8_t i = 0; i < sizeof(data); i++)
+					data[i] = rng();
+				uint16_t fn = rng();
+
+				for (uint8_t lich_cnt = 0; lich_cnt < 6; lich_cnt++)
+				{
+					float out[SYM_PER_FRA], ref[SYM_PER_FRA];
+
+					frame_encoder::gen_frame(out, data, FRAME_STR, &lsf, lich_cnt, fn);
+					::gen_frame(ref, data, FRAME_STR, &lsf, lich_cnt, fn);
+					BOOST_CHECK_EQUAL_COLLECTIONS(out, out + SYM_PER_FRA, ref, ref + SYM_PER_FRA);
+				}
+			}
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
@@ -0,0 +1,103 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include "m17.h"
+#include "golay_decoder.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// soft bits of a codeword through gaussian noise, sigma relative to 0..0xFFFF
+		static void soft_codeword(uint16_t out[24], uint32_t cw, float sigma, std::mt19937 &rng)
+		{
+			std::normal_distribution<float> noise(0.0f, 1.0f);
+
+			for (uint8_t j = 0; j < 24; j++)
+			{
+				float x = ((cw >> (23 - j)) & 1) ? 1.0f : 0.0f;
+				x += sigma * noise(rng);
+				out[j] = std::max(0L, std::min(0xFFFFL, lrintf(x * 0xFFFF)));
+			}
+		}
+
+		// libm17's result, and the distance the decoder should report with it
+		static uint16_t reference(const uint16_t codeword[24], uint32_t *dist)
+		{
+			uint16_t data = golay24_sdecode(codeword);
+
+			*dist = 24 * 0xFFFF;
+			if (data != 0xFFFF)
+			{
+				uint32_t cw = golay24_encode(data);
+				*dist = 0;
+				for (uint8_t j = 0; j < 24; j++)
+					*dist += ((cw >> (23 - j)) & 1) ? 0xFFFF - codeword[j] : codeword[j];
+			}
+			return data;
+		}
+
+		static void check(const uint16_t codeword[24], const char *what, int t)
+		{
+			uint32_t dist, dist_ref;
+			uint16_t data = golay_decoder::decode(codeword, &dist);
+			uint16_t data_ref = reference(codeword, &dist_ref);
+
+			BOOST_REQUIRE_MESSAGE(data == data_ref && dist == dist_ref,
+								  what << " codeword " << t << ": " << data << " dist " << dist
+									   << ", libm17 " << data_ref << " dist " << dist_ref);
+		}
+
+		BOOST_AUTO_TEST_CASE(t1_clean_codewords)
+		{
+			for (uint16_t data = 0; data < 4096; data++)
+			{
+				uint16_t codeword[24];
+				uint32_t cw = golay24_encode(data), dist;
+
+				for (uint8_t j = 0; j < 24; j++)
+					codeword[j] = ((cw >> (23 - j)) & 1) ? 0xFFFF : 0x0000;
+
+				BOOST_REQUIRE_EQUAL(golay_decoder::decode(codeword, &dist), data);
+				BOOST_REQUIRE_EQUAL(dist, 0);
+			}
+		}
+
+		BOOST_AUTO_TEST_CASE(t2_noisy_codewords)
+		{
+			std::mt19937 rng(1);
+
+			for (int t = 0; t < 200000; t++)
+			{
+				uint16_t codeword[24];
+
+				soft_codeword(codeword, golay24_encode(rng() & 0xFFF), (t % 11) * 0.1f, rng);
+				check(codeword, "noisy", t);
+			}
+		}
+
+		BOOST_AUTO_TEST_CASE(t3_random_codewords)
+		{
+			std::mt19937 rng(2);
+
+			for (int t = 0; t < 50000; t++)
+			{
+				uint16_t codeword[24];
+
+				for (uint8_t j = 0; j < 24; j++)
+					codeword[j] = (t & 1) ? rng() : ((rng() & 1) ? 0xFFFF : 0x0000);
+				check(codeword, "random", t);
+			}
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
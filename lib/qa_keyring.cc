@@ -0,0 +1,199 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <random>
+#include "keyring.h"
+#include "aes_engine.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+#define TYPE_3200 ((2 << 3) | (2 << 1) | 1) //AES-128, voice, stream
+#define TYPE_1600 ((2 << 3) | (3 << 1) | 1) //AES-128, voice+data, stream
+
+		// codec2's pack(): index on n bits, MSB first
+		static void pack(uint8_t *bits, unsigned *nbit, unsigned index, unsigned n)
+		{
+			for (unsigned i = 0; i < n; i++, (*nbit)++)
+				if ((index >> (n - 1 - i)) & 1)
+					bits[*nbit / 8] |= 0x80 >> (*nbit % 8);
+		}
+
+		// a codec2_encode_1600 () frame: V1 V2 Wo(7) E(5) V3 V4 Wo(7) E(5) LSP(36)
+		static void pack_1600(uint8_t bits[8], const uint16_t wo[2], const uint16_t e[2], std::mt19937 &rng)
+		{
+			unsigned nbit = 0;
+
+			memset(bits, 0, 8);
+			for (uint8_t i = 0; i < 2; i++)
+			{
+				pack(bits, &nbit, rng() & 1, 1);
+				pack(bits, &nbit, rng() & 1, 1);
+				pack(bits, &nbit, wo[i], 7);
+				pack(bits, &nbit, e[i], 5);
+			}
+			for (uint8_t i = 0; i < 9; i++)
+				pack(bits, &nbit, rng() & 0xF, 4);
+			BOOST_REQUIRE_EQUAL(nbit, 64);
+		}
+
+		BOOST_AUTO_TEST_CASE(t1_codec2_1600_params)
+		{
+			std::mt19937 rng(1);
+			const uint16_t wo[2] = {93, 41}, e[2] = {17, 6};
+			uint8_t payload[16] = {0};
+			uint16_t wo_rx[2], e_rx[2];
+
+			pack_1600(payload, wo, e, rng);
+			memset(&payload[8], 0xFF, 8); // data half
+
+			BOOST_REQUIRE_EQUAL(keyring::codec2_params(TYPE_1600, payload, wo_rx, e_rx), 2);
+			for (uint8_t i = 0; i < 2; i++)
+			{
+				BOOST_CHECK_EQUAL(wo_rx[i], wo[i]);
+				BOOST_CHECK_EQUAL(e_rx[i], e[i]);
+			}
+		}
+
+		// two codec2_encode_3200 () frames: V1 V2 Wo(7) E(5) LSP(50)
+		BOOST_AUTO_TEST_CASE(t2_codec2_3200_params)
+		{
+			const uint16_t wo[2] = {77, 12}, e[2] = {3, 30};
+			uint8_t payload[16] = {0};
+			uint16_t wo_rx[2], e_rx[2];
+			unsigned nbit = 0;
+
+			for (uint8_t i = 0; i < 2; i++)
+			{
+				pack(payload, &nbit, 1, 1);
+				pack(payload, &nbit, 1, 1);
+				pack(payload, &nbit, wo[i], 7);
+				pack(payload, &nbit, e[i], 5);
+				for (uint8_t j = 0; j < 5; j++)
+					pack(payload, &nbit, 0x2AA, 10);
+			}
+			BOOST_REQUIRE_EQUAL(nbit, 128);
+
+			BOOST_REQUIRE_EQUAL(keyring::codec2_params(TYPE_3200, payload, wo_rx, e_rx), 2);
+			for (uint8_t i = 0; i < 2; i++)
+			{
+				BOOST_CHECK_EQUAL(wo_rx[i], wo[i]);
+				BOOST_CHECK_EQUAL(e_rx[i], e[i]);
+			}
+			BOOST_CHECK_EQUAL(keyring::codec2_params(0x0003, payload, wo_rx, e_rx), 0); // data
+		}
+
+		// a 1600 bps voice+data stream encrypted with the second of three keys,
+		// frame fn: Wo and E move slowly, everything else is random
+		static void make_frames(uint8_t frames[][16], int n, const lsf_t *lsf, const uint8_t key[32])
+		{
+			std::mt19937 rng(2);
+			aes_engine aes;
+
+			aes.set_key(key, 0);
+			for (int fn = 0; fn < n; fn++)
+			{
+				const uint16_t wo[2] = {(uint16_t)(60 + fn), (uint16_t)(61 + fn)};
+				const uint16_t e[2] = {(uint16_t)(12 + (fn & 1)), 12};
+				uint8_t iv[16];
+
+				pack_1600(frames[fn], wo, e, rng);
+				for (uint8_t i = 8; i < 16; i++)
+					frames[fn][i] = rng();
+
+				memcpy(iv, lsf->meta, 14);
+				iv[14] = (fn >> 8) & 0x7F;
+				iv[15] = fn & 0xFF;
+				aes.ctr_crypt(iv, frames[fn]);
+			}
+		}
+
+		static void make_lsf(lsf_t *lsf, uint8_t iv_seed)
+		{
+			memset(lsf, 0, sizeof(lsf_t));
+			encode_callsign_bytes(lsf->dst, (const uint8_t *)"AB2CDE");
+			encode_callsign_bytes(lsf->src, (const uint8_t *)"AB1CDE");
+			lsf->type[1] = TYPE_1600;
+			for (uint8_t i = 0; i < 14; i++)
+				lsf->meta[i] = iv_seed + 17 * i;
+		}
+
+		static const char *KEYS =
+			"*=aes:000102030405060708090A0B0C0D0E0F,"
+			"*=aes:2B7E151628AED2A6ABF7158809CF4F3C,"
+			"*=aes:F0E1D2C3B4A5968778695A4B3C2D1E0F";
+		static const uint8_t KEY_1[32] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+										  0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+
+		BOOST_AUTO_TEST_CASE(t3_trial_1600)
+		{
+			lsf_t lsf;
+			uint8_t frames[KEYRING_TRIAL_FRAMES][16];
+			keyring kr;
+
+			make_lsf(&lsf, 1);
+			make_frames(frames, KEYRING_TRIAL_FRAMES, &lsf, KEY_1);
+
+			BOOST_REQUIRE_EQUAL(kr.load(KEYS), 3);
+			BOOST_REQUIRE_EQUAL(kr.start(&lsf), 3);
+			for (int fn = 0; fn < KEYRING_TRIAL_FRAMES; fn++)
+				BOOST_CHECK_EQUAL(kr.decrypt(frames[fn], fn), fn == KEYRING_TRIAL_FRAMES - 1);
+			BOOST_CHECK_EQUAL(kr.winner(), 1);
+
+			// the plaintext is back
+			uint16_t wo[2], e[2];
+			BOOST_REQUIRE_EQUAL(keyring::codec2_params(TYPE_1600, frames[KEYRING_TRIAL_FRAMES - 1], wo, e), 2);
+			BOOST_CHECK_EQUAL(wo[0], 60 + KEYRING_TRIAL_FRAMES - 1);
+			BOOST_CHECK_EQUAL(e[1], 12);
+		}
+
+		// the LSF of the trial sent again leaves it running, a new LSF restarts it
+		BOOST_AUTO_TEST_CASE(t4_restart_on_new_lsf)
+		{
+			lsf_t lsf, stale;
+			uint8_t frames[2 * KEYRING_TRIAL_FRAMES][16];
+			keyring kr;
+
+			make_lsf(&lsf, 1);
+			make_lsf(&stale, 2);
+			make_frames(frames, 2 * KEYRING_TRIAL_FRAMES, &lsf, KEY_1);
+			kr.load(KEYS);
+
+			// late entry: the trial starts on a stale LSF, then the LICH gives the LSF
+			kr.start(&stale);
+			kr.decrypt(frames[0], 0);
+			kr.start(&lsf);
+
+			int fn = 1;
+			for (; fn < KEYRING_TRIAL_FRAMES; fn++)
+			{
+				BOOST_CHECK(!kr.decrypt(frames[fn], fn));
+				kr.start(&lsf);
+			}
+			BOOST_CHECK(kr.decrypt(frames[fn], fn));
+			BOOST_CHECK_EQUAL(kr.winner(), 1);
+		}
+
+		// a CAN selector is a number, alone or followed by the destination
+		BOOST_AUTO_TEST_CASE(t5_can_selector)
+		{
+			keyring kr;
+
+			BOOST_CHECK_EQUAL(kr.load("can:5=scr:1234"), 1);
+			BOOST_CHECK_EQUAL(kr.load("can:5/AB1CDE=scr:1234"), 1);
+			BOOST_CHECK_EQUAL(kr.load("can:5x=scr:1234"), 0);
+			BOOST_CHECK_EQUAL(kr.load("can:5x/AB1CDE=scr:1234"), 0);
+			BOOST_CHECK_EQUAL(kr.load("can:/AB1CDE=scr:1234"), 0);
+			BOOST_CHECK_EQUAL(kr.load("can:16=scr:1234"), 0);
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
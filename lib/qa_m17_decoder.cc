@@ -0,0 +1,236 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <gnuradio/blocks/message_debug.h>
+#include <gnuradio/blocks/vector_sink.h>
+#include <gnuradio/blocks/vector_source.h>
+#include <gnuradio/m17/m17_decoder.h>
+#include <gnuradio/top_block.h>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <vector>
+#include "m17.h"
+#include "frame_encoder.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// the LSF a test stream is sent with
+		static lsf_t test_lsf(const char *src)
+		{
+			lsf_t lsf;
+			memset(&lsf, 0, sizeof(lsf));
+			encode_callsign_bytes(lsf.dst, (const uint8_t *)"AB2CDE");
+			encode_callsign_bytes(lsf.src, (const uint8_t *)src);
+			lsf.type[1] = 0x05; // stream, data
+			update_LSF_CRC(&lsf);
+			return lsf;
+		}
+
+		// symbols of a stream: preamble, the LSF frame if given (late entry otherwise),
+		// one stream frame per LICH_CNT, EoT unless cut; payload byte i of frame fn
+		// is fn * 16 + i
+		static std::vector<float> test_stream(const uint8_t *lich_cnt, uint16_t frames,
+											  const char *src = "AB1CDE", bool cut = false,
+											  const lsf_t *lsf_frame = nullptr)
+		{
+			lsf_t lsf = test_lsf(src);
+			uint8_t lsf_ext[sizeof(lsf_t) + 5] = {0}; // LICH_CNT 6 reads one chunk past the LSF
+			memcpy(lsf_ext, &lsf, sizeof(lsf));
+
+			std::vector<float> sym(SYM_PER_FRA, 0.0f);
+			float frame[SYM_PER_FRA];
+			uint32_t cnt = 0;
+
+			gen_preamble(frame, &cnt, PREAM_LSF);
+			sym.insert(sym.end(), frame, frame + SYM_PER_FRA);
+			if (lsf_frame != nullptr)
+			{
+				frame_encoder::gen_frame(frame, nullptr, FRAME_LSF, lsf_frame, 0, 0);
+				sym.insert(sym.end(), frame, frame + SYM_PER_FRA);
+			}
+
+			for (uint16_t fn = 0; fn < frames; fn++)
+			{
+				uint8_t data[16];
+				for (uint8_t i = 0; i < 16; i++)
+					data[i] = fn * 16 + i;
+				frame_encoder::gen_frame(frame, data, FRAME_STR, (const lsf_t *)lsf_ext, lich_cnt[fn],
+										 (fn == frames - 1 && !cut) ? (fn | 0x8000) : fn);
+				sym.insert(sym.end(), frame, frame + SYM_PER_FRA);
+			}
+			if (cut)
+				return sym;
+
+			cnt = 0;
+			gen_eot(frame, &cnt);
+			sym.insert(sym.end(), frame, frame + SYM_PER_FRA);
+			sym.insert(sym.end(), 2 * SYM_PER_FRA, 0.0f);
+			return sym;
+		}
+
+		// a locked frame whose LICH_CNT is out of range: its payload is still output,
+		// its LICH is not merged into the LSF, the other chunks still make one
+		BOOST_AUTO_TEST_CASE(t1_lich_cnt_out_of_range)
+		{
+			const uint8_t lich_cnt[7] = {0, 1, 6, 2, 3, 4, 5};
+
+			top_block_sptr tb = make_top_block("qa_m17_decoder");
+			blocks::vector_source_f::sptr src = blocks::vector_source_f::make(test_stream(lich_cnt, 7));
+			m17_decoder::sptr dec = m17_decoder::make(false, false, 2.0, 30.0, false, false, 0, "", "");
+			blocks::vector_sink_b::sptr snk = blocks::vector_sink_b::make();
+			blocks::message_debug::sptr dbg = blocks::message_debug::make();
+
+			dec->set_flywheel(2);
+			tb->connect(src, 0, dec, 0);
+			tb->connect(dec, 0, snk, 0);
+			tb->msg_connect(dec, "fields", dbg, "store");
+			tb->run();
+
+			const std::vector<unsigned char> &out = snk->data();
+			BOOST_REQUIRE_EQUAL(out.size(), 7 * 16);
+			for (size_t i = 0; i < out.size(); i++)
+				BOOST_CHECK_EQUAL(out[i], i);
+
+			// "start" once chunk 5 completes the LSF, "end" with the last frame
+			BOOST_REQUIRE_EQUAL(dbg->num_messages(), 2);
+			pmt::pmt_t start = dbg->get_message(0);
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(start, pmt::mp("event"), pmt::PMT_NIL), pmt::mp("start")));
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(start, pmt::mp("src"), pmt::PMT_NIL), pmt::mp("AB1CDE")));
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(start, pmt::mp("dst"), pmt::PMT_NIL), pmt::mp("AB2CDE")));
+		}
+
+		// a stream cut without EoT and followed by another one ends before the next starts
+		BOOST_AUTO_TEST_CASE(t2_stream_without_eot)
+		{
+			const uint8_t lich_cnt[7] = {0, 1, 2, 3, 4, 5, 0};
+
+			std::vector<float> sym = test_stream(lich_cnt, 7, "AB1CDE", true);
+			std::vector<float> next = test_stream(lich_cnt, 7, "XY9ZZZ");
+			sym.insert(sym.end(), next.begin(), next.end());
+
+			top_block_sptr tb = make_top_block("qa_m17_decoder");
+			blocks::vector_source_f::sptr src = blocks::vector_source_f::make(sym);
+			m17_decoder::sptr dec = m17_decoder::make(false, false, 2.0, 30.0, false, false, 0, "", "");
+			blocks::vector_sink_b::sptr snk = blocks::vector_sink_b::make();
+			blocks::message_debug::sptr dbg = blocks::message_debug::make();
+
+			tb->connect(src, 0, dec, 0);
+			tb->connect(dec, 0, snk, 0);
+			tb->msg_connect(dec, "fields", dbg, "store");
+			tb->run();
+
+			BOOST_CHECK_EQUAL(snk->data().size(), 2 * 7 * 16);
+
+			const char *event[4] = {"start", "end", "start", "end"};
+			const char *call[4] = {"AB1CDE", "AB1CDE", "XY9ZZZ", "XY9ZZZ"};
+			BOOST_REQUIRE_EQUAL(dbg->num_messages(), 4);
+			for (int i = 0; i < 4; i++)
+			{
+				pmt::pmt_t msg = dbg->get_message(i);
+				BOOST_CHECK(pmt::eq(pmt::dict_ref(msg, pmt::mp("event"), pmt::PMT_NIL), pmt::mp(event[i])));
+				BOOST_CHECK(pmt::eq(pmt::dict_ref(msg, pmt::mp("src"), pmt::PMT_NIL), pmt::mp(call[i])));
+			}
+		}
+
+		// a stream of 10 superframes in buffers longer than the fields timeout:
+		// one start, one end, whatever the buffer boundaries
+		BOOST_AUTO_TEST_CASE(t3_large_buffers)
+		{
+			uint8_t lich_cnt[60];
+			for (uint8_t fn = 0; fn < 60; fn++)
+				lich_cnt[fn] = fn % 6;
+
+			top_block_sptr tb = make_top_block("qa_m17_decoder");
+			blocks::vector_source_f::sptr src = blocks::vector_source_f::make(test_stream(lich_cnt, 60));
+			m17_decoder::sptr dec = m17_decoder::make(false, false, 2.0, 30.0, false, false, 0, "", "");
+			blocks::vector_sink_b::sptr snk = blocks::vector_sink_b::make();
+			blocks::message_debug::sptr dbg = blocks::message_debug::make();
+
+			src->set_max_noutput_items(4 * 1024); // > FIELDS_END_SUPERFRAMES superframes of symbols
+			tb->connect(src, 0, dec, 0);
+			tb->connect(dec, 0, snk, 0);
+			tb->msg_connect(dec, "fields", dbg, "store");
+			tb->run();
+
+			BOOST_CHECK_EQUAL(snk->data().size(), 60 * 16);
+			BOOST_REQUIRE_EQUAL(dbg->num_messages(), 2);
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(dbg->get_message(0), pmt::mp("event"), pmt::PMT_NIL), pmt::mp("start")));
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(dbg->get_message(1), pmt::mp("event"), pmt::PMT_NIL), pmt::mp("end")));
+		}
+
+		// an LSF frame that decodes with a good metric but a wrong CRC is not used,
+		// the stream only starts once the LICH gives its LSF
+		BOOST_AUTO_TEST_CASE(t4_lsf_crc_error)
+		{
+			uint8_t lich_cnt[12];
+			for (uint8_t fn = 0; fn < 12; fn++)
+				lich_cnt[fn] = fn % 6;
+
+			lsf_t bad = test_lsf("AB1CDE");
+			encode_callsign_bytes(bad.src, (const uint8_t *)"XY9ZZZ"); // CRC not updated
+
+			top_block_sptr tb = make_top_block("qa_m17_decoder");
+			blocks::vector_source_f::sptr src = blocks::vector_source_f::make(test_stream(lich_cnt, 12, "AB1CDE", false, &bad));
+			m17_decoder::sptr dec = m17_decoder::make(false, false, 2.0, 30.0, false, false, 0, "", "");
+			blocks::vector_sink_b::sptr snk = blocks::vector_sink_b::make();
+			blocks::message_debug::sptr dbg = blocks::message_debug::make();
+
+			tb->connect(src, 0, dec, 0);
+			tb->connect(dec, 0, snk, 0);
+			tb->msg_connect(dec, "fields", dbg, "store");
+			tb->run();
+
+			BOOST_CHECK_EQUAL(snk->data().size(), 12 * 16);
+
+			const char *event[2] = {"start", "end"};
+			BOOST_REQUIRE_EQUAL(dbg->num_messages(), 2);
+			for (int i = 0; i < 2; i++)
+			{
+				pmt::pmt_t msg = dbg->get_message(i);
+				BOOST_CHECK(pmt::eq(pmt::dict_ref(msg, pmt::mp("event"), pmt::PMT_NIL), pmt::mp(event[i])));
+				BOOST_CHECK(pmt::eq(pmt::dict_ref(msg, pmt::mp("src"), pmt::PMT_NIL), pmt::mp("AB1CDE")));
+			}
+		}
+
+		// the squelch enabled in the middle of a stream, without preamble: the noise
+		// floor is learned on the stream itself, the periodic search still finds it
+		BOOST_AUTO_TEST_CASE(t5_squelch_late_entry)
+		{
+			uint8_t lich_cnt[60];
+			for (uint8_t fn = 0; fn < 60; fn++)
+				lich_cnt[fn] = fn % 6;
+
+			std::vector<float> sym = test_stream(lich_cnt, 60);
+			sym.erase(sym.begin(), sym.begin() + 2 * SYM_PER_FRA + 500); // inside the 3rd frame
+
+			top_block_sptr tb = make_top_block("qa_m17_decoder");
+			blocks::vector_source_f::sptr src = blocks::vector_source_f::make(sym);
+			m17_decoder::sptr dec = m17_decoder::make(false, false, 2.0, 30.0, false, false, 0, "", "");
+			blocks::vector_sink_b::sptr snk = blocks::vector_sink_b::make();
+			blocks::message_debug::sptr dbg = blocks::message_debug::make();
+
+			dec->set_squelch(0.5);
+			tb->connect(src, 0, dec, 0);
+			tb->connect(dec, 0, snk, 0);
+			tb->msg_connect(dec, "fields", dbg, "store");
+			tb->run();
+
+			// decoded up to the last frame
+			const std::vector<unsigned char> &out = snk->data();
+			BOOST_REQUIRE_GE(out.size(), 16);
+			BOOST_CHECK_EQUAL(out.back(), (59 * 16 + 15) & 0xFF);
+
+			BOOST_REQUIRE_EQUAL(dbg->num_messages(), 2);
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(dbg->get_message(0), pmt::mp("event"), pmt::PMT_NIL), pmt::mp("start")));
+			BOOST_CHECK(pmt::eq(pmt::dict_ref(dbg->get_message(1), pmt::mp("event"), pmt::PMT_NIL), pmt::mp("end")));
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
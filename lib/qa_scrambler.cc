@@ -0,0 +1,95 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include "scrambler.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// one LFSR step as the blocks used to run it, one bit at a time
+		static uint32_t step(int8_t subtype, uint32_t *lfsr)
+		{
+			uint32_t bit;
+
+			if (subtype == 0)
+				bit = (*lfsr >> 7) ^ (*lfsr >> 5) ^ (*lfsr >> 4) ^ (*lfsr >> 3);
+			else if (subtype == 1)
+				bit = (*lfsr >> 15) ^ (*lfsr >> 14) ^ (*lfsr >> 12) ^ (*lfsr >> 3);
+			else if (subtype == 2)
+				bit = (*lfsr >> 23) ^ (*lfsr >> 22) ^ (*lfsr >> 21) ^ (*lfsr >> 16);
+			else
+				bit = 0;
+
+			bit &= 1;
+			*lfsr = ((*lfsr << 1) | bit) & 0xFFFFFF;
+			return bit;
+		}
+
+		// the seed of every frame number, jumped and stepped, for all three
+		// polynomials and an unknown subtype; every FN up to a few superframes,
+		// then each power of two, the largest FN and random ones
+		BOOST_AUTO_TEST_CASE(t1_jump)
+		{
+			const uint32_t seed_mask[4] = {0xFF, 0xFFFF, 0xFFFFFF, 0xFFFFFF};
+			std::mt19937 rng(3);
+
+			for (int8_t subtype = 0; subtype < 4; subtype++)
+			{
+				uint32_t seed = (rng() & seed_mask[subtype]) | 1;
+				uint32_t lfsr = seed;
+
+				for (uint32_t fn = 0; fn < 300; fn++)
+				{
+					BOOST_CHECK_EQUAL(scrambler::jump(subtype, seed, fn), lfsr);
+					for (int i = 0; i < 128; i++)
+						step(subtype, &lfsr);
+				}
+
+				for (int k = 0; k < SCRAMBLER_JUMPS + 4; k++)
+				{
+					uint32_t fn = (k < SCRAMBLER_JUMPS) ? (1u << k) : (k == SCRAMBLER_JUMPS) ? 0x7FFF : rng() & 0x7FFF;
+					lfsr = seed;
+					for (uint32_t i = 0; i < 128 * fn; i++)
+						step(subtype, &lfsr);
+					BOOST_CHECK_MESSAGE(scrambler::jump(subtype, seed, fn) == lfsr,
+										"subtype " << (int)subtype << " FN " << fn);
+				}
+			}
+		}
+
+		// the keystream of consecutive frames, generated 16 bits at a time and stepped
+		// bit by bit (MSB first), and the seed left for the next frame
+		BOOST_AUTO_TEST_CASE(t2_keystream)
+		{
+			const uint32_t seed_mask[4] = {0xFF, 0xFFFF, 0xFFFFFF, 0xFFFFFF};
+			std::mt19937 rng(13);
+
+			for (int8_t subtype = 0; subtype < 4; subtype++)
+			{
+				uint32_t seed = (rng() & seed_mask[subtype]) | 1;
+				uint32_t lfsr = seed;
+
+				for (int frame = 0; frame < 100; frame++)
+				{
+					uint8_t out[16], ref[16] = {0};
+					for (int i = 0; i < 128; i++)
+						ref[i / 8] |= step(subtype, &lfsr) << (7 - i % 8);
+					lfsr &= seed_mask[subtype];
+
+					scrambler::keystream(subtype, &seed, out);
+					BOOST_CHECK_EQUAL_COLLECTIONS(out, out + 16, ref, ref + 16);
+					BOOST_CHECK_EQUAL(seed, lfsr);
+				}
+			}
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
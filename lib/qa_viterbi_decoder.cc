@@ -0,0 +1,148 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <random>
+#include "m17.h"
+#include "viterbi_decoder.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+#define QA_FRAMES 3000 //frames per input kind
+
+		// deinterleaved, derandomized soft bits of an LSF or stream frame sent
+		// through gaussian noise; every fifth frame is random soft bits instead
+		static void frame_soft_bits(uint16_t out[2 * SYM_PER_PLD], bool lsf, float sigma, std::mt19937 &rng)
+		{
+			std::normal_distribution<float> noise(0.0f, 1.0f);
+			float frame[SYM_PER_FRA];
+			uint16_t soft[2 * SYM_PER_PLD];
+			uint8_t data[16];
+			lsf_t l;
+
+			for (uint8_t i = 0; i < sizeof(l); i++)
+				((uint8_t *)&l)[i] = rng();
+			for (uint8_t i = 0; i < sizeof(data); i++)
+				data[i] = rng();
+			gen_frame(frame, data, lsf ? FRAME_LSF : FRAME_STR, &l, rng() % 6, rng() & 0x7FFF);
+
+			for (uint16_t i = SYM_PER_SWD; i < SYM_PER_FRA; i++)
+				frame[i] += sigma * noise(rng);
+			slice_symbols(soft, &frame[SYM_PER_SWD]);
+			randomize_soft_bits(soft);
+			reorder_soft_bits(out, soft);
+		}
+
+		// the input of the Viterbi decoder for frame t: LSF or stream payload,
+		// noise from none to well past the decoding limit, or random soft bits
+		typedef struct
+		{
+			uint16_t soft[2 * SYM_PER_PLD];
+			const uint16_t *in;
+			const uint8_t *punct;
+			uint16_t in_len, p_len;
+			uint8_t out_len;
+		} input_t;
+
+		static void make_input(input_t *inp, int t, std::mt19937 &rng)
+		{
+			const bool lsf = t & 1;
+
+			if (t % 5 == 4)
+				for (uint16_t i = 0; i < 2 * SYM_PER_PLD; i++)
+					inp->soft[i] = (t % 10 == 4) ? rng() : ((rng() & 1) ? 0xFFFF : 0x0000);
+			else
+				frame_soft_bits(inp->soft, lsf, (t % 7) * 0.2f, rng);
+
+			inp->in = lsf ? inp->soft : &inp->soft[96];
+			inp->punct = lsf ? puncture_pattern_1 : puncture_pattern_2;
+			inp->in_len = lsf ? 2 * SYM_PER_PLD : 272;
+			inp->p_len = lsf ? sizeof(puncture_pattern_1) : sizeof(puncture_pattern_2);
+			inp->out_len = lsf ? 31 : 19;
+		}
+
+		// false if the CPU does not have it
+		static bool use_impl(viterbi_decoder &v, int impl)
+		{
+			v.set_impl((viterbi_decoder::impl_t)impl);
+			if (v.impl() == impl)
+				return true;
+			BOOST_TEST_MESSAGE("Viterbi impl " << impl << " not supported, skipped");
+			return false;
+		}
+
+		BOOST_AUTO_TEST_CASE(t1_soft16_vs_libm17)
+		{
+			for (int impl = viterbi_decoder::VITERBI_SCALAR; impl <= viterbi_decoder::VITERBI_AVX2; impl++)
+			{
+				viterbi_decoder v;
+				std::mt19937 rng(1);
+				input_t inp;
+
+				if (!use_impl(v, impl))
+					continue;
+
+				for (int t = 0; t < QA_FRAMES; t++)
+				{
+					uint8_t out[32], ref[32];
+
+					make_input(&inp, t, rng);
+					uint32_t e = v.decode_punctured(out, inp.in, inp.punct, inp.in_len, inp.p_len);
+					uint32_t e_ref = viterbi_decode_punctured(ref, inp.in, inp.punct, inp.in_len, inp.p_len);
+
+					BOOST_REQUIRE_MESSAGE(e == e_ref && memcmp(out, ref, inp.out_len) == 0,
+										  v.impl_name() << ": frame " << t << " differs from libm17");
+				}
+			}
+		}
+
+		// 8-bit soft bits b decode as libm17 decodes b * 0x101 with erasures of 0x7F7F
+		// instead of 0x7FFF: depunctured here for viterbi_decode (), metric included
+		BOOST_AUTO_TEST_CASE(t2_soft8_vs_libm17)
+		{
+			for (int impl = viterbi_decoder::VITERBI_SCALAR; impl <= viterbi_decoder::VITERBI_AVX2; impl++)
+			{
+				viterbi_decoder v;
+				std::mt19937 rng(2);
+				input_t inp;
+
+				if (!use_impl(v, impl))
+					continue;
+
+				for (int t = 0; t < QA_FRAMES; t++)
+				{
+					uint8_t in8[2 * SYM_PER_PLD], out[32], ref[32];
+					uint16_t umsg[2 * VITERBI_MAX_STEPS], u = 0, p = 0;
+
+					make_input(&inp, t, rng);
+					for (uint16_t i = 0; i < inp.in_len; i++)
+					{
+						in8[i] = inp.in[i] >> 8;
+						while (inp.punct[p] == 0)
+						{
+							umsg[u++] = 0x7F7F;
+							p = (p + 1) % inp.p_len;
+						}
+						umsg[u++] = in8[i] * 0x101;
+						p = (p + 1) % inp.p_len;
+					}
+
+					uint32_t e = v.decode_punctured(out, in8, inp.punct, inp.in_len, inp.p_len);
+					uint32_t e_ref = viterbi_decode(ref, umsg, u) - (u - inp.in_len) * 0x7F7F;
+
+					BOOST_REQUIRE_MESSAGE(e == e_ref && memcmp(out, ref, inp.out_len) == 0,
+										  v.impl_name() << " 8-bit: frame " << t << " differs from libm17");
+				}
+			}
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
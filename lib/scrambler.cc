@@ -0,0 +1,156 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "scrambler.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// feedback taps of the 8, 16 and 24-bit polynomials, and none for an unknown subtype
+		static constexpr uint32_t SCRAMBLER_TAPS[4] = {0x0000B8, 0x00D008, 0xE10000, 0};
+
+		static constexpr uint32_t parity(uint32_t v)
+		{
+			v ^= v >> 16;
+			v ^= v >> 8;
+			v ^= v >> 4;
+			v ^= v >> 2;
+			v ^= v >> 1;
+			return v & 1;
+		}
+
+		// the next 16 bits of each polynomial from each register byte alone,
+		// the 16 bits of any register are the XOR of its 3 bytes' entries
+		struct word_table_t
+		{
+			uint16_t word[4][3][256];
+
+			constexpr word_table_t() : word()
+			{
+				for (int s = 0; s < 4; s++)
+					for (int n = 0; n < 3; n++)
+						for (int b = 0; b < 256; b++)
+						{
+							uint32_t lfsr = (uint32_t)b << (8 * n);
+							uint16_t w = 0;
+							for (int i = 0; i < 16; i++)
+							{
+								uint32_t bit = parity(lfsr & SCRAMBLER_TAPS[s]);
+								lfsr = ((lfsr << 1) | bit) & 0xFFFFFF;
+								w = (w << 1) | bit;
+							}
+							word[s][n][b] = w;
+						}
+			}
+		};
+		static constexpr word_table_t WORD_TABLE{};
+
+		// 24x24 GF(2) matrices stored as columns: column j is the image of bit j
+		struct gf2_matrix_t
+		{
+			uint32_t col[24];
+
+			constexpr gf2_matrix_t() : col() {}
+
+			constexpr uint32_t apply(uint32_t v) const
+			{
+				uint32_t r = 0;
+				for (int j = 0; j < 24; j++)
+					r ^= col[j] & -((v >> j) & 1);
+				return r;
+			}
+
+			constexpr gf2_matrix_t square() const
+			{
+				gf2_matrix_t m;
+				for (int j = 0; j < 24; j++)
+					m.col[j] = apply(col[j]);
+				return m;
+			}
+		};
+
+		// powers M^(128 * 2^k) of the one step map M of each polynomial
+		struct jump_table_t
+		{
+			gf2_matrix_t pow[3][SCRAMBLER_JUMPS];
+
+			constexpr jump_table_t() : pow()
+			{
+				for (int s = 0; s < 3; s++)
+				{
+					// one step: shift left, feedback parity into bit 0
+					gf2_matrix_t m;
+					for (int j = 0; j < 24; j++)
+						m.col[j] = ((1u << (j + 1)) & 0xFFFFFF) | ((SCRAMBLER_TAPS[s] >> j) & 1);
+
+					for (int i = 0; i < 7; i++) // 128 steps, one frame
+						m = m.square();
+
+					pow[s][0] = m;
+					for (int k = 1; k < SCRAMBLER_JUMPS; k++)
+						pow[s][k] = pow[s][k - 1].square();
+				}
+			}
+		};
+		static constexpr jump_table_t JUMP_TABLE{};
+
+		uint32_t scrambler::jump(int8_t subtype, uint32_t seed, uint32_t fn)
+		{
+			uint32_t lfsr = seed & 0xFFFFFF;
+
+			if (fn == 0)
+				return seed;
+			if (subtype < 0 || subtype > 2) // no feedback, 128 shifts clear the register
+				return 0;
+
+			for (int k = 0; k < SCRAMBLER_JUMPS; k++)
+				if ((fn >> k) & 1)
+					lfsr = JUMP_TABLE.pow[subtype][k].apply(lfsr);
+
+			return lfsr;
+		}
+
+		int8_t scrambler::subtype(uint32_t seed)
+		{
+			if (seed > 0xFF && seed <= 0xFFFF)
+				return 1; // 16-bit key
+			else if (seed > 0xFFFF && seed <= 0xFFFFFF)
+				return 2; // 24-bit key
+			else
+				return 0; // 8-bit key, also the default
+		}
+
+		void scrambler::keystream(int8_t subtype, uint32_t *seed, uint8_t out[16])
+		{
+			const uint16_t(*t)[256] = WORD_TABLE.word[(subtype >= 0 && subtype <= 2) ? subtype : 3];
+			uint32_t lfsr = *seed & 0xFFFFFF;
+
+			for (uint8_t i = 0; i < 16; i += 2)
+			{
+				uint16_t w = t[0][lfsr & 0xFF] ^ t[1][(lfsr >> 8) & 0xFF] ^ t[2][lfsr >> 16];
+				lfsr = ((lfsr << 16) | w) & 0xFFFFFF;
+				out[i] = w >> 8;
+				out[i + 1] = w & 0xFF;
+			}
+
+			// truncate seed so subtype will continue to set properly on subsequent passes
+			if (subtype == 0)
+				lfsr &= 0xFF;
+			else if (subtype == 1)
+				lfsr &= 0xFFFF;
+
+			*seed = lfsr;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
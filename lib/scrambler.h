@@ -0,0 +1,45 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_SCRAMBLER_H
+#define INCLUDED_M17_SCRAMBLER_H
+
+#include <stdint.h>
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * M17 scrambler LFSRs (8, 16 and 24-bit polynomials, in a 24-bit register).
+ * One LFSR step is a linear map over GF(2), so the register 128*fn steps
+ * ahead is a product of precomputed powers of that map, one per set bit of
+ * fn: the seed of any frame takes at most 15 matrix-vector products
+ * instead of up to 4 million steps.
+ * The keystream is generated 16 bits at a time: 16 steps ahead, the new
+ * bits are a linear function of the register, so they are the XOR of one
+ * table lookup per register byte.
+ */
+    class scrambler
+    {
+    public:
+#define SCRAMBLER_JUMPS 15	//frame numbers are 15-bit
+      // register after 128*fn steps from seed, same as stepping it
+      static uint32_t jump (int8_t subtype, uint32_t seed, uint32_t fn);
+
+      // subtype (0: 8-bit, 1: 16-bit, 2: 24-bit) implied by the size of a seed
+      static int8_t subtype (uint32_t seed);
+
+      // keystream of one frame (128 bits), the seed is updated for the next frame
+      static void keystream (int8_t subtype, uint32_t * seed, uint8_t out[16]);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_SCRAMBLER_H */
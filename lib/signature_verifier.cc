@@ -0,0 +1,90 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "signature_verifier.h"
+#include "uECC.h"
+
+namespace gr
+{
+	namespace m17
+	{
+
+		signature_verifier::signature_verifier(callback_t done, int threads) : _done(done)
+		{
+			for (int i = 0; i < threads; i++)
+				_workers.emplace_back(&signature_verifier::worker, this);
+		}
+
+		signature_verifier::~signature_verifier()
+		{
+			stop();
+		}
+
+		bool signature_verifier::submit(const job_t &job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_stop || _jobs.size() >= SIG_MAX_JOBS)
+				{
+					_dropped++;
+					return false;
+				}
+				_jobs.push_back(job);
+			}
+			_cond.notify_one();
+			return true;
+		}
+
+		void signature_verifier::stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stop = true;
+				_jobs.clear();
+			}
+			_cond.notify_all();
+
+			for (auto &w : _workers)
+				if (w.joinable())
+					w.join();
+			_workers.clear();
+		}
+
+		uint64_t signature_verifier::dropped()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return _dropped;
+		}
+
+		void signature_verifier::worker()
+		{
+			// the curve parameters are constant, uECC_verify() has no other state
+			const struct uECC_Curve_t *curve = uECC_secp256r1();
+
+			while (true)
+			{
+				job_t job;
+				{
+					std::unique_lock<std::mutex> lock(_mutex);
+					_cond.wait(lock, [this] { return _stop || !_jobs.empty(); });
+					if (_stop)
+						return;
+					job = _jobs.front();
+					_jobs.pop_front();
+				}
+
+				job.valid = uECC_verify(job.key, job.digest, sizeof(job.digest), job.sig, curve);
+				_done(job);
+			}
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
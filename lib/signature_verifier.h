@@ -0,0 +1,69 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_SIGNATURE_VERIFIER_H
+#define INCLUDED_M17_SIGNATURE_VERIFIER_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * ECDSA (P-256) stream signature checks on a small pool of worker threads,
+ * so that the few milliseconds of uECC_verify() never hold up the block's
+ * work() call. Jobs are copies of everything the check needs; the result
+ * is handed to a callback, on the worker thread, together with the job.
+ * When SIG_MAX_JOBS checks are already pending the new one is dropped.
+ */
+    class signature_verifier
+    {
+    public:
+      typedef struct
+      {
+	lsf_t lsf;		//LSF of the signed stream, its identity
+	uint8_t digest[16];	//stream digest
+	uint8_t sig[64];	//ECDSA signature
+	uint8_t key[64];	//public key
+	bool valid;		//result, set by the worker
+      } job_t;
+      typedef std::function < void (const job_t &) > callback_t;
+
+#define SIG_THREADS 2		//worker threads
+#define SIG_MAX_JOBS 16		//pending checks
+        signature_verifier (callback_t done, int threads = SIG_THREADS);
+       ~signature_verifier ();
+
+      bool submit (const job_t & job);	//false if the queue is full
+      void stop ();		//waits for the check in progress, drops the others
+      uint64_t dropped ();
+
+    private:
+        callback_t _done;
+        std::vector < std::thread > _workers;
+        std::deque < job_t > _jobs;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+      bool _stop = false;
+      uint64_t _dropped = 0;
+
+      void worker ();
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_SIGNATURE_VERIFIER_H */
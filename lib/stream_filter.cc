@@ -0,0 +1,113 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "stream_filter.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		int stream_filter::load(const std::string &rules)
+		{
+			std::vector<rule_t> loaded;
+			const char *sep = ",; \t\r\n";
+			size_t pos = 0;
+
+			while ((pos = rules.find_first_not_of(sep, pos)) != std::string::npos)
+			{
+				size_t end = rules.find_first_of(sep, pos);
+				std::string item = rules.substr(pos, end - pos);
+				pos = end;
+
+				size_t eq = item.find('=');
+				std::string sel = item.substr(0, eq);
+				std::string val = sel.size() > 4 ? sel.substr(4) : "";
+				rule_t r = {};
+				bool ok = !val.empty();
+				char *num_end;
+
+				r.port = -1;
+				if (ok && eq != std::string::npos)
+				{
+					long port = strtol(item.c_str() + eq + 1, &num_end, 10);
+					ok = (num_end != item.c_str() + eq + 1) && (*num_end == 0) && (port >= 0) && (port < FILTER_MAX_PORTS);
+					r.port = port;
+				}
+
+				if (ok && sel.compare(0, 4, "can:") == 0)
+				{
+					long can = strtol(val.c_str(), &num_end, 10);
+					ok = (*num_end == 0) && (can >= 0) && (can <= 15);
+					r.kind = RULE_CAN;
+					r.can = can;
+				}
+				else if (ok && (sel.compare(0, 4, "src:") == 0 || sel.compare(0, 4, "dst:") == 0))
+				{
+					for (auto &c : val)
+						c = toupper(c); // the M17 charset has no lower case
+					ok = val.size() <= 9 && encode_callsign_bytes(r.call, (const uint8_t *)val.c_str()) == 0;
+					r.kind = (sel[0] == 's') ? RULE_SRC : RULE_DST;
+				}
+				else
+					ok = false;
+
+				if (!ok)
+				{
+					printf("Stream filter rule ignored: %s\n", item.c_str());
+					continue;
+				}
+
+				loaded.push_back(r);
+			}
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_rules.swap(loaded);
+			return _rules.size();
+		}
+
+		int stream_filter::route(const lsf_t *lsf)
+		{
+			const uint16_t type = ((uint16_t)lsf->type[0] << 8) + lsf->type[1];
+			const uint8_t can = (type >> 7) & 0xF;
+			bool has[3] = {false, false, false}, match[3] = {false, false, false};
+			int port = -1;
+
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			for (const rule_t &r : _rules)
+			{
+				bool m;
+				if (r.kind == RULE_CAN)
+					m = (r.can == can);
+				else
+					m = memcmp(r.call, (r.kind == RULE_SRC) ? lsf->src : lsf->dst, sizeof(r.call)) == 0;
+
+				has[r.kind] = true;
+				match[r.kind] |= m;
+				if (m && port < 0 && r.port >= 0)
+					port = r.port;
+			}
+
+			for (uint8_t k = 0; k < 3; k++)
+				if (has[k] && !match[k])
+					return -1;
+
+			return (port < 0) ? 0 : port;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
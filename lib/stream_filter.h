@@ -0,0 +1,65 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_STREAM_FILTER_H
+#define INCLUDED_M17_STREAM_FILTER_H
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Which streams the decoder decodes, and on which output port, from the
+ * CAN, source and destination of their LSF. Rules of the same kind are
+ * alternatives, rules of different kinds must all match: "can:1,can:2,
+ * dst:TG1" keeps the streams to TG1 on CAN 1 or 2. A rule may also name
+ * an output port, used by the streams it matches (the first such rule
+ * wins), the others go to port 0. No rules: everything on port 0.
+ */
+    class stream_filter
+    {
+    public:
+#define FILTER_MAX_PORTS 8	//decoder output ports
+      // rules "can:N", "src:CALLSIGN" or "dst:CALLSIGN", each optionally
+      // followed by "=port", separated by commas, semicolons or whitespace;
+      // replaces the current rules, returns the number loaded
+      int load (const std::string & rules);
+
+      // output port of the stream, -1 if it is filtered out
+      int route (const lsf_t * lsf);
+
+    private:
+      typedef enum
+      {
+	RULE_CAN,
+	RULE_SRC,
+	RULE_DST
+      } kind_t;
+
+      typedef struct
+      {
+	kind_t kind;
+	uint8_t can;
+	uint8_t call[6];	//encoded callsign
+	int8_t port;		//-1 - none
+      } rule_t;
+
+        std::vector < rule_t > _rules;
+        std::mutex _mutex;
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_STREAM_FILTER_H */
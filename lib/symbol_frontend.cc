@@ -0,0 +1,214 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "symbol_frontend.h"
+#include "m17.h"
+
+#include <gnuradio/math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		symbol_frontend::symbol_frontend(int input_type, int sps) : _type(input_type), _sps(sps)
+		{
+			if (_type == m17_decoder::INPUT_COMPLEX)
+			{
+				// libm17 provides the RRC taps for 5 and 10 samples per symbol
+				if (_sps == 10)
+					_taps.assign(rrc_taps_10, rrc_taps_10 + 8 * 10 + 1);
+				else if (_sps == 5)
+					_taps.assign(rrc_taps_5, rrc_taps_5 + 8 * 5 + 1);
+				else
+					throw std::invalid_argument("m17_decoder: complex input needs 5 or 10 samples per symbol");
+			}
+			else if (_type != m17_decoder::INPUT_FLOAT)
+				throw std::invalid_argument("m17_decoder: unknown input type");
+			else if (_sps < 1)
+				throw std::invalid_argument("m17_decoder: at least 1 sample per symbol needed");
+
+			if (!_taps.empty())
+			{
+				float sum = 0.0f;
+				for (float t : _taps)
+					sum += t;
+				for (float &t : _taps)
+					t /= sum;
+				_x.assign(_taps.size() - 1, 0.0f);
+			}
+
+			// +3 symbol = 2.4 kHz deviation = pi/sps radians per sample
+			_fm_gain = 3.0f * _sps / M_PI;
+
+			_y.assign((FRONTEND_LAG + 1) * _sps, 0.0f);
+			_correlator.set_sps(_sps);
+		}
+
+		size_t symbol_frontend::item_size(int input_type)
+		{
+			switch (input_type)
+			{
+			case m17_decoder::INPUT_COMPLEX:
+				return sizeof(gr_complex);
+			default:
+				return sizeof(float);
+			}
+		}
+
+		int symbol_frontend::sps()
+		{
+			return _sps;
+		}
+
+		void symbol_frontend::set_threshold(float threshold)
+		{
+			_correlator.set_threshold(threshold);
+		}
+
+		void symbol_frontend::set_dc_removal(bool dc_removal)
+		{
+			_correlator.set_dc_removal(dc_removal);
+		}
+
+		void symbol_frontend::set_search(bool search)
+		{
+			// the look-back of the correlator is stale after a pause
+			if (search && !_search)
+				_correlator.reset();
+			_search = search;
+		}
+
+		// output the symbols sampled before the given sample index
+		void symbol_frontend::emit(uint64_t until, std::vector<float> &out, int *found)
+		{
+			const uint64_t first = _count - (_y.size() - (FRONTEND_LAG + 1) * _sps); // sample index of _y[h]
+			const float *y = _y.data() + (FRONTEND_LAG + 1) * _sps;
+
+			for (; _next < until; _next += _sps)
+			{
+				out.push_back(y[(int64_t)(_next - first)]);
+				(*found)++;
+			}
+		}
+
+		// the best hit of a syncword sets the sampling phase, starting with the syncword itself
+		void symbol_frontend::retime(std::vector<float> &out, int *found)
+		{
+			const uint64_t start = _cl_best - (SYM_PER_SWD - 1) * _sps; // first syncword sample
+
+			if (_cl_best >= (uint64_t)SYM_PER_SWD * _sps) // not on the initial (zero) history
+			{
+				emit(start - _sps / 2, out, found);
+				_next = start;
+			}
+			_cl_active = false;
+		}
+
+		int symbol_frontend::process(const void *in, int n, std::vector<float> &out)
+		{
+			const int h = _taps.size() - 1;
+			const int yh = (FRONTEND_LAG + 1) * _sps;
+			int found = 0;
+
+			for (int start = 0; start < n; start += FRONTEND_CHUNK)
+			{
+				int len = std::min(FRONTEND_CHUNK, n - start);
+
+				_y.resize(yh + len);
+				float *y = _y.data() + yh;
+
+				if (_type == m17_decoder::INPUT_COMPLEX)
+				{
+					_x.resize(h + len);
+					float *x = _x.data() + h;
+
+					// FM discriminator
+					const gr_complex *c = (const gr_complex *)in + start;
+					for (int i = 0; i < len; i++)
+					{
+						gr_complex d = c[i] * std::conj(_last);
+						_last = c[i];
+						x[i] = _fm_gain * gr::fast_atan2f(d.imag(), d.real());
+					}
+
+					// matched filter (symmetric taps), one tap at a time over the chunk
+					memset(y, 0, len * sizeof(float));
+					for (int k = 0; k <= h; k++)
+					{
+						const float t = _taps[k];
+						const float *xk = _x.data() + k;
+						for (int i = 0; i < len; i++)
+							y[i] += t * xk[i];
+					}
+
+					// filter history for the next chunk
+					memmove(_x.data(), _x.data() + len, h * sizeof(float));
+				}
+				else
+					memcpy(y, (const float *)in + start, len * sizeof(float));
+
+				_count += len;
+
+				if (_sps == 1)
+				{
+					out.insert(out.end(), y, y + len);
+					found += len;
+				}
+				else
+				{
+					// syncword on all phases, the hits of one syncword are less than a symbol apart
+					_hits.clear();
+					if (_search)
+						_correlator.scan(y, len, _hits);
+
+					for (auto &hit : _hits)
+					{
+						uint64_t idx = _count - len + hit.offset;
+
+						if (_cl_active && idx - _cl_first >= (uint64_t)_sps)
+							retime(out, &found);
+
+						if (!_cl_active)
+						{
+							_cl_active = true;
+							_cl_first = idx;
+							_cl_dist = hit.dist;
+							_cl_best = idx;
+						}
+						else if (hit.dist < _cl_dist)
+						{
+							_cl_dist = hit.dist;
+							_cl_best = idx;
+						}
+					}
+
+					if (_cl_active && _count - _cl_first > (uint64_t)_sps)
+						retime(out, &found);
+
+					// a syncword not found yet starts after this
+					if (_count > (uint64_t)FRONTEND_LAG * _sps)
+						emit(_count - FRONTEND_LAG * _sps, out, &found);
+				}
+
+				// keep the unsent samples
+				memmove(_y.data(), _y.data() + len, yh * sizeof(float));
+				_y.resize(yh);
+			}
+
+			return found;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
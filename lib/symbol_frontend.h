@@ -0,0 +1,77 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_SYMBOL_FRONTEND_H
+#define INCLUDED_M17_SYMBOL_FRONTEND_H
+
+#include <gnuradio/m17/m17_decoder.h>
+#include <gnuradio/types.h>
+#include <vector>
+#include "sync_correlator.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Decoder input stage: turns the block input into symbol-rate floats.
+ * Complex baseband goes through the FM discriminator and the RRC matched
+ * filter in one pass over a cache-sized chunk. At more than one sample per
+ * symbol, the syncword is searched on all sampling phases at once and the
+ * best phase of each syncword is used until the next one: no timing loop.
+ * The symbols are output FRONTEND_LAG symbols late, so that the syncword
+ * itself is already sampled at its own phase. The search can be turned
+ * off while the decoder is idle: the symbols keep the last phase.
+ * There is no integer input: the squelch, the syncword search and fit and
+ * the slicers all work on float symbols, so 16 or 8-bit symbols would be
+ * converted here anyway, which costs a pass that float input at 1 sample
+ * per symbol does not have.
+ */
+    class symbol_frontend
+    {
+    public:
+      symbol_frontend (int input_type, int sps);
+
+      static size_t item_size (int input_type);	//size of one input item
+      int sps ();
+      void set_threshold (float threshold);
+      void set_dc_removal (bool dc_removal);
+      void set_search (bool search);	//look for syncwords on all phases
+
+      // convert n input items, append the symbols to out,
+      // return the number of symbols appended
+      int process (const void *in, int n, std::vector < float >&out);
+
+    private:
+#define FRONTEND_CHUNK 4096	//input items per pass
+#define FRONTEND_LAG (SYM_PER_SWD + 1)	//output delay, in symbols
+      int _type;
+      int _sps;
+      std::vector < float >_taps;	//RRC matched filter, unit DC gain
+      float _fm_gain;		//discriminator output to symbol levels
+      gr_complex _last = 0;	//previous sample, for the discriminator
+      std::vector < float >_x;	//filter history followed by the discriminator output
+      std::vector < float >_y;	//output history followed by the new samples
+      sync_correlator _correlator;	//syncword search over all phases
+      std::vector < sync_correlator::hit_t > _hits;
+      bool _search = true;	//syncword search on
+      uint64_t _count = 0;	//samples processed so far
+      uint64_t _next = 0;	//sample index of the next symbol
+      bool _cl_active = false;	//hits of the current syncword, one per phase
+      uint64_t _cl_first;	//sample index of the first hit
+      uint64_t _cl_best;	//sample index of the best hit
+      float _cl_dist;		//distance of the best hit
+
+      void emit (uint64_t until, std::vector < float >&out, int *found);
+      void retime (std::vector < float >&out, int *found);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_SYMBOL_FRONTEND_H */
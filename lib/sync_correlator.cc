@@ -0,0 +1,231 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "sync_correlator.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace gr
+{
+	namespace m17
+	{
+
+		sync_correlator::sync_correlator()
+		{
+			reset();
+		}
+
+		void sync_correlator::reset()
+		{
+			_hist.assign((SYM_PER_SWD - 1) * _sps, 0.0f);
+		}
+
+		void sync_correlator::set_sps(int sps)
+		{
+			_sps = (sps > 1) ? sps : 1;
+			reset();
+		}
+
+		void sync_correlator::set_threshold(float threshold)
+		{
+			_threshold2 = threshold * threshold;
+		}
+
+		void sync_correlator::set_dc_removal(bool dc_removal)
+		{
+			_dc_removal = dc_removal;
+		}
+
+		float sync_correlator::threshold()
+		{
+			return sqrtf(_threshold2);
+		}
+
+		void sync_correlator::set_false_alarm_rate(float pfa)
+		{
+			_pfa = (pfa > 0.0f && pfa < 1.0f) ? pfa : 0.0f;
+			memset(_hist_cnt, 0, sizeof(_hist_cnt));
+			_hist_total = 0;
+		}
+
+		float sync_correlator::distance(const float *x, sync_t type)
+		{
+			const float sign = (type == SYNC_STR) ? 1.0f : -1.0f;
+			float mx = 0.0f, ms = 0.0f;
+
+			if (_dc_removal)
+			{
+				for (int k = 0; k < SYM_PER_SWD; k++)
+				{
+					mx += x[k * _sps];
+					ms += sign * str_sync_symbols[k];
+				}
+				mx /= SYM_PER_SWD;
+				ms /= SYM_PER_SWD;
+			}
+
+			float d = 0.0f;
+			for (int k = 0; k < SYM_PER_SWD; k++)
+			{
+				float e = (x[k * _sps] - mx) - (sign * str_sync_symbols[k] - ms);
+				d += e * e;
+			}
+
+			return sqrtf(d);
+		}
+
+		void sync_correlator::fit(const float *x, sync_t type, float *scale, float *offset)
+		{
+			const float sign = (type == SYNC_STR) ? 1.0f : -1.0f;
+			float mx = 0.0f, ms = 0.0f;
+
+			for (int k = 0; k < SYM_PER_SWD; k++)
+			{
+				mx += x[k * _sps];
+				ms += sign * str_sync_symbols[k];
+			}
+			mx /= SYM_PER_SWD;
+			ms /= SYM_PER_SWD;
+
+			float cov = 0.0f, var = 0.0f;
+			for (int k = 0; k < SYM_PER_SWD; k++)
+			{
+				float s = sign * str_sync_symbols[k] - ms;
+				cov += (x[k * _sps] - mx) * s;
+				var += s * s;
+			}
+
+			*scale = cov / var;
+			*offset = mx - *scale * ms;
+		}
+
+		int sync_correlator::scan(const float *in, int n, std::vector<hit_t> &hits)
+		{
+			const int h = (SYM_PER_SWD - 1) * _sps;
+			int found = 0;
+
+			if (n <= 0)
+				return 0;
+
+			_buf.resize(n + h);
+			_corr.assign(n, 0.0f);
+			_energy.assign(n, 0.0f);
+			if (_dc_removal)
+				_sum.assign(n, 0.0f);
+
+			memcpy(_buf.data(), _hist.data(), h * sizeof(float));
+			memcpy(_buf.data() + h, in, n * sizeof(float));
+
+			const float *buf = _buf.data();
+			float *corr = _corr.data();
+			float *energy = _energy.data();
+
+			// one pass per tap over the whole buffer - no branches, vectorizes
+			for (int k = 0; k < SYM_PER_SWD; k++)
+			{
+				const float s = str_sync_symbols[k];
+				const float *x = buf + k * _sps;
+
+				for (int i = 0; i < n; i++)
+				{
+					corr[i] += s * x[i];
+					energy[i] += x[i] * x[i];
+				}
+			}
+
+			// |s|^2 is the same for both syncwords
+			float sw_energy = 0.0f, sw_sum = 0.0f;
+			for (int k = 0; k < SYM_PER_SWD; k++)
+			{
+				sw_energy += str_sync_symbols[k] * str_sync_symbols[k];
+				sw_sum += str_sync_symbols[k];
+			}
+
+			_dmin.resize(n);
+			float *dmin = _dmin.data();
+
+			if (_dc_removal)
+			{
+				float *sum = _sum.data();
+
+				for (int k = 0; k < SYM_PER_SWD; k++)
+				{
+					const float *x = buf + k * _sps;
+					for (int i = 0; i < n; i++)
+						sum[i] += x[i];
+				}
+
+				// |x-mx - (s-ms)|^2 = |x|^2 - N*mx^2 + |s|^2 - N*ms^2 - 2(<x,s> - N*mx*ms)
+				// the sign of s flips both <x,s> and ms, so |.| still picks the syncword
+				sw_energy -= sw_sum * sw_sum / SYM_PER_SWD;
+				for (int i = 0; i < n; i++)
+				{
+					corr[i] -= sum[i] * sw_sum / SYM_PER_SWD;
+					energy[i] -= sum[i] * sum[i] / SYM_PER_SWD;
+				}
+			}
+
+			// squared distance to the closest of the two syncwords
+			for (int i = 0; i < n; i++)
+				dmin[i] = energy[i] + sw_energy - 2.0f * fabsf(corr[i]);
+
+			for (int i = 0; i < n; i++)
+			{
+				if (dmin[i] >= _threshold2)
+					continue;
+
+				hit_t hit;
+				hit.offset = i;
+				hit.type = (corr[i] >= 0.0f) ? SYNC_STR : SYNC_LSF; // closer to the stream syncword?
+				hit.dist = sqrtf(fmaxf(dmin[i], 0.0f));
+				fit(buf + i, hit.type, &hit.scale, &hit.dc);
+				hits.push_back(hit);
+				found++;
+			}
+
+			// adaptive threshold - hits are rare enough not to bias the noise statistics
+			if (_pfa > 0.0f)
+			{
+				const float max2 = CFAR_MAX_THRESHOLD * CFAR_MAX_THRESHOLD;
+				const float bin = max2 / CFAR_BINS;
+				float a = fminf((float)n / CFAR_WINDOW, 1.0f);
+
+				for (int b = 0; b < CFAR_BINS; b++)
+					_hist_cnt[b] *= 1.0f - a;
+				_hist_total = _hist_total * (1.0f - a) + n;
+
+				// only the lower tail is of interest
+				for (int i = 0; i < n; i++)
+					if (dmin[i] < max2)
+						_hist_cnt[(int)(fmaxf(dmin[i], 0.0f) / bin)] += 1.0f;
+
+				// lowest distance at which the expected false alarms reach the target
+				float target = _pfa * _hist_total;
+				float cum = 0.0f;
+				int b = 0;
+				while (b < CFAR_BINS && cum + _hist_cnt[b] < target)
+					cum += _hist_cnt[b++];
+
+				float thr2 = max2;
+				if (b < CFAR_BINS) // interpolate inside the bin
+					thr2 = bin * (b + (target - cum) / _hist_cnt[b]);
+				_threshold2 = fmaxf(thr2, CFAR_MIN_THRESHOLD * CFAR_MIN_THRESHOLD);
+			}
+
+			// keep the tail for windows straddling the next buffer
+			memcpy(_hist.data(), buf + n, h * sizeof(float));
+
+			return found;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
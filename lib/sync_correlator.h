@@ -0,0 +1,91 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_SYNC_CORRELATOR_H
+#define INCLUDED_M17_SYNC_CORRELATOR_H
+
+#include <vector>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Block-wise syncword search. The stream and LSF syncwords are exact
+ * negatives of each other, so a single correlation against the stream
+ * pattern plus the window energy gives the Euclidean distance to both:
+ *   |x-s|^2 = |x|^2 - 2<x,s> + |s|^2,  <x,s_lsf> = -<x,s_str>
+ * The correlation and energy are accumulated tap by tap over the whole
+ * input buffer, which the compiler turns into straight SIMD loops.
+ * With DC removal, the window and syncword means are subtracted first,
+ * which only needs the window sum on top of that.
+ * At more than one sample per symbol the taps are sps samples apart, so
+ * every sampling phase is searched in the same pass.
+ */
+    class sync_correlator
+    {
+    public:
+      typedef enum
+      {
+	SYNC_STR,		//stream frame syncword
+	SYNC_LSF		//link setup frame syncword
+      } sync_t;
+
+      typedef struct
+      {
+	int offset;		//index of the last syncword sample in the scanned buffer
+	sync_t type;
+	float dist;		//Euclidean distance to the syncword
+	float scale;		//symbol scale fitted on the syncword (1 - nominal deviation)
+	float dc;		//DC offset fitted on the syncword
+      } hit_t;
+
+        sync_correlator ();
+
+      void reset ();		//clear the look-back history
+      void set_threshold (float threshold);
+      void set_false_alarm_rate (float pfa);	//0 - fixed threshold
+      void set_dc_removal (bool dc_removal);
+      void set_sps (int sps);	//samples per symbol, clears the history
+      float threshold ();
+
+      // distance between the 8 symbols at x and a syncword, as used by scan()
+      float distance (const float *x, sync_t type);
+      // least squares fit x = scale*syncword + offset
+      void fit (const float *x, sync_t type, float *scale, float *offset);
+
+      // scan n samples, append every syncword candidate to hits,
+      // return the number of candidates found
+      int scan (const float *in, int n, std::vector < hit_t > &hits);
+
+    private:
+      float _threshold2 = 4.0;	//squared distance threshold
+      bool _dc_removal = false;	//ignore the DC offset when measuring distances
+      int _sps = 1;		//tap spacing
+//CFAR: histogram of the squared distance of non-sync windows, the threshold
+//is placed where its lower tail holds the target false alarm rate
+#define CFAR_WINDOW 48000	//averaging length of the noise statistics, in symbols
+#define CFAR_BINS 64		//histogram bins over 0..CFAR_MAX_THRESHOLD^2
+#define CFAR_MIN_THRESHOLD 0.25	//distance limits of the adaptive threshold
+#define CFAR_MAX_THRESHOLD 4.0
+      float _pfa = 0;		//target false alarm probability per symbol
+      float _hist_cnt[CFAR_BINS] = { 0 };	//decaying histogram of the distance
+      float _hist_total = 0;	//decaying number of windows seen
+      std::vector < float >_dmin;	//distance to the closest syncword
+      std::vector < float >_hist;	//last samples of the previous buffer
+      std::vector < float >_buf;	//history followed by the new samples
+      std::vector < float >_corr;	//correlation against str_sync_symbols
+      std::vector < float >_energy;	//window energy
+      std::vector < float >_sum;	//window sum, for DC removal
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_SYNC_CORRELATOR_H */
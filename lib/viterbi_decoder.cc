@@ -0,0 +1,410 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "viterbi_decoder.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VITERBI_X86
+#include <immintrin.h>
+#endif
+
+namespace gr
+{
+	namespace m17
+	{
+
+		// expected soft bits of the two encoder outputs for each butterfly,
+		// 0 or 0xFFFF, so |C-s| is just C^s
+		static const uint16_t COST_TABLE_0[8] = {0, 0, 0, 0, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF};
+		static const uint16_t COST_TABLE_1[8] = {0, 0xFFFF, 0xFFFF, 0, 0, 0xFFFF, 0xFFFF, 0};
+
+		viterbi_decoder::viterbi_decoder()
+		{
+			set_impl(VITERBI_AVX2);
+		}
+
+		void viterbi_decoder::set_impl(impl_t impl)
+		{
+			_impl = VITERBI_SCALAR;
+
+#ifdef VITERBI_X86
+			if (impl == VITERBI_AVX2 && __builtin_cpu_supports("avx2"))
+				_impl = VITERBI_AVX2;
+			else if (impl >= VITERBI_SSE2 && __builtin_cpu_supports("sse2"))
+				_impl = VITERBI_SSE2;
+#endif
+		}
+
+		viterbi_decoder::impl_t viterbi_decoder::impl()
+		{
+			return _impl;
+		}
+
+		const char *viterbi_decoder::impl_name()
+		{
+			switch (_impl)
+			{
+			case VITERBI_AVX2:
+				return "AVX2";
+			case VITERBI_SSE2:
+				return "SSE2";
+			default:
+				return "scalar";
+			}
+		}
+
+		uint32_t viterbi_decoder::decode_punctured(uint8_t *out, const uint16_t *in, const uint8_t *punct,
+												   uint16_t in_len, uint16_t p_len)
+		{
+			uint16_t p = 0, u = 0;
+
+			// punctured bits are erasures, halfway between 0 and 1
+			for (uint16_t i = 0; i < in_len; i++)
+			{
+				while (punct[p] == 0)
+				{
+					_umsg[u++] = 0x7FFF;
+					if (++p == p_len)
+						p = 0;
+				}
+				_umsg[u++] = in[i];
+				if (++p == p_len)
+					p = 0;
+			}
+
+			switch (_impl)
+			{
+			case VITERBI_AVX2:
+				acs_avx2(_umsg, u / 2);
+				break;
+			case VITERBI_SSE2:
+				acs_sse2(_umsg, u / 2);
+				break;
+			default:
+				acs_scalar(_umsg, u / 2);
+			}
+
+			// remove the cost of the erasures
+			return chainback(out, u / 2) - (u - in_len) * 0x7FFF;
+		}
+
+		uint32_t viterbi_decoder::decode_punctured(uint8_t *out, const uint8_t *in, const uint8_t *punct,
+												   uint16_t in_len, uint16_t p_len)
+		{
+			uint16_t p = 0, u = 0;
+			uint32_t offset;
+
+			for (uint16_t i = 0; i < in_len; i++)
+			{
+				while (punct[p] == 0)
+				{
+					_umsg8[u++] = 0x7F;
+					if (++p == p_len)
+						p = 0;
+				}
+				_umsg8[u++] = in[i];
+				if (++p == p_len)
+					p = 0;
+			}
+
+			if (_impl >= VITERBI_SSE2)
+				offset = acs8_sse2(_umsg8, u / 2);
+			else
+				offset = acs8_scalar(_umsg8, u / 2);
+
+			// back to 16-bit soft bit units, so that the thresholds do not change
+			return (offset + chainback(out, u / 2) - (u - in_len) * 0x7F) * 0x101;
+		}
+
+		void viterbi_decoder::acs_scalar(const uint16_t *in, int steps)
+		{
+			uint32_t prev[16] = {0}, curr[16];
+
+			for (int s = 0; s < steps; s++)
+			{
+				uint16_t hist = 0;
+
+				for (uint8_t i = 0; i < 8; i++)
+				{
+					uint32_t metric = (COST_TABLE_0[i] ^ in[2 * s]) + (COST_TABLE_1[i] ^ in[2 * s + 1]);
+					uint32_t m0 = prev[i] + metric;
+					uint32_t m1 = prev[i + 8] + (0x1FFFE - metric);
+					uint32_t m2 = prev[i] + (0x1FFFE - metric);
+					uint32_t m3 = prev[i + 8] + metric;
+
+					// ties go to the second path, as in libm17
+					if (m0 >= m1)
+					{
+						hist |= 1 << (2 * i);
+						curr[2 * i] = m1;
+					}
+					else
+						curr[2 * i] = m0;
+
+					if (m2 >= m3)
+					{
+						hist |= 1 << (2 * i + 1);
+						curr[2 * i + 1] = m3;
+					}
+					else
+						curr[2 * i + 1] = m2;
+				}
+
+				_history[s] = hist;
+				memcpy(prev, curr, sizeof(prev));
+			}
+
+			memcpy(_metrics, prev, sizeof(_metrics));
+		}
+
+		uint32_t viterbi_decoder::acs8_scalar(const uint8_t *in, int steps)
+		{
+			uint32_t prev[16] = {0}, curr[16];
+
+			for (int s = 0; s < steps; s++)
+			{
+				uint16_t hist = 0;
+
+				for (uint8_t i = 0; i < 8; i++)
+				{
+					uint32_t metric = ((COST_TABLE_0[i] & 0xFF) ^ in[2 * s]) + ((COST_TABLE_1[i] & 0xFF) ^ in[2 * s + 1]);
+					uint32_t m0 = prev[i] + metric;
+					uint32_t m1 = prev[i + 8] + (0x1FE - metric);
+					uint32_t m2 = prev[i] + (0x1FE - metric);
+					uint32_t m3 = prev[i + 8] + metric;
+
+					if (m0 >= m1)
+					{
+						hist |= 1 << (2 * i);
+						curr[2 * i] = m1;
+					}
+					else
+						curr[2 * i] = m0;
+
+					if (m2 >= m3)
+					{
+						hist |= 1 << (2 * i + 1);
+						curr[2 * i + 1] = m3;
+					}
+					else
+						curr[2 * i + 1] = m2;
+				}
+
+				_history[s] = hist;
+				memcpy(prev, curr, sizeof(prev));
+			}
+
+			memcpy(_metrics, prev, sizeof(_metrics));
+			return 0;
+		}
+
+#ifdef VITERBI_X86
+		// metrics stay below 2^31 (244 steps of at most 0x1FFFE), so the
+		// signed compares of SSE2/AVX2 are fine
+		__attribute__((target("sse2"))) void viterbi_decoder::acs_sse2(const uint16_t *in, int steps)
+		{
+			const __m128i c0[2] = {_mm_setr_epi32(COST_TABLE_0[0], COST_TABLE_0[1], COST_TABLE_0[2], COST_TABLE_0[3]),
+								   _mm_setr_epi32(COST_TABLE_0[4], COST_TABLE_0[5], COST_TABLE_0[6], COST_TABLE_0[7])};
+			const __m128i c1[2] = {_mm_setr_epi32(COST_TABLE_1[0], COST_TABLE_1[1], COST_TABLE_1[2], COST_TABLE_1[3]),
+								   _mm_setr_epi32(COST_TABLE_1[4], COST_TABLE_1[5], COST_TABLE_1[6], COST_TABLE_1[7])};
+			const __m128i max = _mm_set1_epi32(0x1FFFE);
+			__m128i p[4] = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+
+			for (int s = 0; s < steps; s++)
+			{
+				const __m128i s0 = _mm_set1_epi32(in[2 * s]);
+				const __m128i s1 = _mm_set1_epi32(in[2 * s + 1]);
+				__m128i np[4];
+				int mask = 0;
+
+				// butterflies 0-3, then 4-7
+				for (int h = 0; h < 2; h++)
+				{
+					__m128i metric = _mm_add_epi32(_mm_xor_si128(c0[h], s0), _mm_xor_si128(c1[h], s1));
+					__m128i inv = _mm_sub_epi32(max, metric);
+					__m128i m0 = _mm_add_epi32(p[h], metric);
+					__m128i m1 = _mm_add_epi32(p[h + 2], inv);
+					__m128i m2 = _mm_add_epi32(p[h], inv);
+					__m128i m3 = _mm_add_epi32(p[h + 2], metric);
+
+					// set where the first path survives, i.e. decision bit 0
+					__m128i d0 = _mm_cmpgt_epi32(m1, m0);
+					__m128i d1 = _mm_cmpgt_epi32(m3, m2);
+					__m128i e = _mm_or_si128(_mm_and_si128(d0, m0), _mm_andnot_si128(d0, m1));
+					__m128i o = _mm_or_si128(_mm_and_si128(d1, m2), _mm_andnot_si128(d1, m3));
+
+					// new states 2i and 2i+1 are next to each other
+					np[2 * h] = _mm_unpacklo_epi32(e, o);
+					np[2 * h + 1] = _mm_unpackhi_epi32(e, o);
+					mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_unpacklo_epi32(d0, d1))) << (8 * h);
+					mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_unpackhi_epi32(d0, d1))) << (8 * h + 4);
+				}
+
+				_history[s] = ~mask & 0xFFFF;
+				for (int i = 0; i < 4; i++)
+					p[i] = np[i];
+			}
+
+			for (int i = 0; i < 4; i++)
+				_mm_storeu_si128((__m128i *)&_metrics[4 * i], p[i]);
+		}
+
+		__attribute__((target("avx2"))) void viterbi_decoder::acs_avx2(const uint16_t *in, int steps)
+		{
+			const __m256i c0 = _mm256_setr_epi32(COST_TABLE_0[0], COST_TABLE_0[1], COST_TABLE_0[2], COST_TABLE_0[3],
+												 COST_TABLE_0[4], COST_TABLE_0[5], COST_TABLE_0[6], COST_TABLE_0[7]);
+			const __m256i c1 = _mm256_setr_epi32(COST_TABLE_1[0], COST_TABLE_1[1], COST_TABLE_1[2], COST_TABLE_1[3],
+												 COST_TABLE_1[4], COST_TABLE_1[5], COST_TABLE_1[6], COST_TABLE_1[7]);
+			const __m256i max = _mm256_set1_epi32(0x1FFFE);
+			__m256i lo = _mm256_setzero_si256(); // states 0-7
+			__m256i hi = _mm256_setzero_si256(); // states 8-15
+
+			for (int s = 0; s < steps; s++)
+			{
+				const __m256i s0 = _mm256_set1_epi32(in[2 * s]);
+				const __m256i s1 = _mm256_set1_epi32(in[2 * s + 1]);
+
+				__m256i metric = _mm256_add_epi32(_mm256_xor_si256(c0, s0), _mm256_xor_si256(c1, s1));
+				__m256i inv = _mm256_sub_epi32(max, metric);
+				__m256i m0 = _mm256_add_epi32(lo, metric);
+				__m256i m1 = _mm256_add_epi32(hi, inv);
+				__m256i m2 = _mm256_add_epi32(lo, inv);
+				__m256i m3 = _mm256_add_epi32(hi, metric);
+
+				__m256i d0 = _mm256_cmpgt_epi32(m1, m0);
+				__m256i d1 = _mm256_cmpgt_epi32(m3, m2);
+				__m256i e = _mm256_blendv_epi8(m1, m0, d0);
+				__m256i o = _mm256_blendv_epi8(m3, m2, d1);
+
+				// the unpacks work within 128-bit lanes, put the states back in order
+				__m256i a = _mm256_unpacklo_epi32(e, o); // 0-3 | 8-11
+				__m256i b = _mm256_unpackhi_epi32(e, o); // 4-7 | 12-15
+				lo = _mm256_permute2x128_si256(a, b, 0x20);
+				hi = _mm256_permute2x128_si256(a, b, 0x31);
+
+				__m256i da = _mm256_unpacklo_epi32(d0, d1);
+				__m256i db = _mm256_unpackhi_epi32(d0, d1);
+				int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_permute2x128_si256(da, db, 0x20))) |
+						   (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_permute2x128_si256(da, db, 0x31))) << 8);
+
+				_history[s] = ~mask & 0xFFFF;
+			}
+
+			_mm256_storeu_si256((__m256i *)&_metrics[0], lo);
+			_mm256_storeu_si256((__m256i *)&_metrics[8], hi);
+		}
+
+		__attribute__((target("sse2"))) uint32_t viterbi_decoder::acs8_sse2(const uint8_t *in, int steps)
+		{
+			const __m128i c0 = _mm_setr_epi16(COST_TABLE_0[0] & 0xFF, COST_TABLE_0[1] & 0xFF, COST_TABLE_0[2] & 0xFF, COST_TABLE_0[3] & 0xFF,
+											  COST_TABLE_0[4] & 0xFF, COST_TABLE_0[5] & 0xFF, COST_TABLE_0[6] & 0xFF, COST_TABLE_0[7] & 0xFF);
+			const __m128i c1 = _mm_setr_epi16(COST_TABLE_1[0] & 0xFF, COST_TABLE_1[1] & 0xFF, COST_TABLE_1[2] & 0xFF, COST_TABLE_1[3] & 0xFF,
+											  COST_TABLE_1[4] & 0xFF, COST_TABLE_1[5] & 0xFF, COST_TABLE_1[6] & 0xFF, COST_TABLE_1[7] & 0xFF);
+			const __m128i max = _mm_set1_epi16(0x1FE);
+			__m128i lo = _mm_setzero_si128(); // states 0-7
+			__m128i hi = _mm_setzero_si128(); // states 8-15
+			uint32_t offset = 0;
+
+			for (int s = 0; s < steps; s++)
+			{
+				const __m128i s0 = _mm_set1_epi16(in[2 * s]);
+				const __m128i s1 = _mm_set1_epi16(in[2 * s + 1]);
+
+				// all 8 butterflies at once
+				__m128i metric = _mm_add_epi16(_mm_xor_si128(c0, s0), _mm_xor_si128(c1, s1));
+				__m128i inv = _mm_sub_epi16(max, metric);
+				__m128i m0 = _mm_add_epi16(lo, metric);
+				__m128i m1 = _mm_add_epi16(hi, inv);
+				__m128i m2 = _mm_add_epi16(lo, inv);
+				__m128i m3 = _mm_add_epi16(hi, metric);
+
+				__m128i d0 = _mm_cmpgt_epi16(m1, m0);
+				__m128i d1 = _mm_cmpgt_epi16(m3, m2);
+				__m128i e = _mm_min_epi16(m0, m1);
+				__m128i o = _mm_min_epi16(m2, m3);
+
+				lo = _mm_unpacklo_epi16(e, o);
+				hi = _mm_unpackhi_epi16(e, o);
+
+				int mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_unpacklo_epi16(d0, d1), _mm_unpackhi_epi16(d0, d1)));
+				_history[s] = ~mask & 0xFFFF;
+
+				// keep the metrics small, relative to state 0
+				int16_t base = _mm_cvtsi128_si32(lo) & 0xFFFF;
+				__m128i b = _mm_set1_epi16(base);
+				lo = _mm_sub_epi16(lo, b);
+				hi = _mm_sub_epi16(hi, b);
+				offset += base;
+			}
+
+			int16_t m[16];
+			_mm_storeu_si128((__m128i *)&m[0], lo);
+			_mm_storeu_si128((__m128i *)&m[8], hi);
+
+			// chainback() looks for the smallest metric, make them all positive
+			int16_t low = m[0];
+			for (uint8_t i = 1; i < 16; i++)
+				if (m[i] < low)
+					low = m[i];
+			for (uint8_t i = 0; i < 16; i++)
+				_metrics[i] = m[i] - low;
+
+			return offset + low;
+		}
+#else
+		uint32_t viterbi_decoder::acs8_sse2(const uint8_t *in, int steps)
+		{
+			return acs8_scalar(in, steps);
+		}
+
+		void viterbi_decoder::acs_sse2(const uint16_t *in, int steps)
+		{
+			acs_scalar(in, steps);
+		}
+
+		void viterbi_decoder::acs_avx2(const uint16_t *in, int steps)
+		{
+			acs_scalar(in, steps);
+		}
+#endif
+
+		// trace the decisions back from state 0 (the encoder is flushed)
+		uint32_t viterbi_decoder::chainback(uint8_t *out, int steps)
+		{
+			uint8_t state = 0;
+			int bit_pos = steps + 4; // same output alignment as libm17
+
+			memset(out, 0, (steps - 1) / 8 + 1);
+
+			for (int s = steps - 1; s >= 0; s--)
+			{
+				bit_pos--;
+				uint16_t bit = _history[s] & (1 << (state >> 4));
+				state >>= 1;
+				if (bit)
+				{
+					state |= 0x80;
+					out[bit_pos / 8] |= 1 << (7 - (bit_pos % 8));
+				}
+			}
+
+			uint32_t cost = _metrics[0];
+			for (uint8_t i = 1; i < 16; i++)
+				if (_metrics[i] < cost)
+					cost = _metrics[i];
+
+			return cost;
+		}
+
+	} /* namespace m17 */
+} /* namespace gr */
@@ -0,0 +1,76 @@
+/* -*- c++ -*- */
+/*
+ * Copyright 2023 jmfriedt.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INCLUDED_M17_VITERBI_DECODER_H
+#define INCLUDED_M17_VITERBI_DECODER_H
+
+#include <stdint.h>
+#include "m17.h"
+
+namespace gr
+{
+  namespace m17
+  {
+
+/*
+ * Soft-decision Viterbi decoder for the K=5 M17 convolutional code.
+ * Bit-exact with libm17's viterbi_decode_punctured(): same decoded bits,
+ * same path metric, same tie breaking. The add-compare-select of the 16
+ * states runs as 8 butterflies on 32-bit metrics, 8 lanes at a time with
+ * AVX2 or 2x4 lanes with SSE2, picked at run time; the scalar version is
+ * used elsewhere. Unlike libm17 there is no global state, so each
+ * instance is reentrant.
+ * The 8-bit soft bit variant keeps 16-bit metrics, renormalized on state
+ * 0 every step (the spread is at most 4 branches of 0x1FE), so a whole
+ * trellis step fits in one SSE2 register. Its error metric is returned
+ * in 16-bit soft bit units, like the 16-bit variant.
+ */
+    class viterbi_decoder
+    {
+    public:
+      typedef enum
+      {
+	VITERBI_SCALAR,
+	VITERBI_SSE2,
+	VITERBI_AVX2
+      } impl_t;
+
+        viterbi_decoder ();
+
+      void set_impl (impl_t impl);	//falls back to the best supported one
+      impl_t impl ();
+      const char *impl_name ();
+
+      // same arguments and return value as libm17's viterbi_decode_punctured()
+      uint32_t decode_punctured (uint8_t * out, const uint16_t * in,
+				 const uint8_t * punct, uint16_t in_len,
+				 uint16_t p_len);
+      // 8-bit soft bits: 0x00 - 0, 0xFF - 1
+      uint32_t decode_punctured (uint8_t * out, const uint8_t * in,
+				 const uint8_t * punct, uint16_t in_len,
+				 uint16_t p_len);
+
+    private:
+#define VITERBI_MAX_STEPS 244	//trellis steps of the longest (LSF) frame
+      impl_t _impl;
+      uint16_t _umsg[2 * VITERBI_MAX_STEPS];	//depunctured soft bits
+      uint8_t _umsg8[2 * VITERBI_MAX_STEPS];	//depunctured 8-bit soft bits
+      uint16_t _history[VITERBI_MAX_STEPS];	//decisions, bits 2i and 2i+1 for butterfly i
+      uint32_t _metrics[16];	//path metrics after the last step
+
+      void acs_scalar (const uint16_t * in, int steps);
+      void acs_sse2 (const uint16_t * in, int steps);
+      void acs_avx2 (const uint16_t * in, int steps);
+      uint32_t acs8_scalar (const uint8_t * in, int steps);	//these return the metric offset
+      uint32_t acs8_sse2 (const uint8_t * in, int steps);
+      uint32_t chainback (uint8_t * out, int steps);
+    };
+
+  }				// namespace m17
+}				// namespace gr
+
+#endif /* INCLUDED_M17_VITERBI_DECODER_H */
@@ -34,8 +34,41 @@ static const char *__doc_gr_m17_m17_decoder_set_vt_threshold = R"doc()doc";
 
 static const char *__doc_gr_m17_m17_decoder_set_signed = R"doc()doc";
 
+static const char *__doc_gr_m17_m17_decoder_set_flywheel = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_false_alarm_rate =
+    R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_sw_threshold = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_false_sync_rate = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_squelch = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_squelch_open = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_normalize = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_soft_bits = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_rejects_lich = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_rejects_viterbi = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_rejects_fn = R"doc()doc";
+
 static const char *__doc_gr_m17_m17_decoder_set_key = R"doc()doc";
 
+static const char *__doc_gr_m17_m17_decoder_set_pub_keys = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_keyring = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_filter = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_frames_filtered = R"doc()doc";
+
+static const char *__doc_gr_m17_m17_decoder_set_output_mode = R"doc()doc";
+
 static const char *__doc_gr_m17_m17_decoder_set_seed = R"doc()doc";
 
 static const char *__doc_gr_m17_m17_decoder_parse_raw_key_string = R"doc()doc";
@@ -16,7 +16,7 @@
 /* BINDTOOL_GEN_AUTOMATIC(0) */
 /* BINDTOOL_USE_PYGCCXML(0) */
 /* BINDTOOL_HEADER_FILE(m17_decoder.h)                                        */
-/* BINDTOOL_HEADER_FILE_HASH(444e5eb27b1f4e418da7b3bfb83128e1) */
+/* BINDTOOL_HEADER_FILE_HASH(3e02bd1a67f77578a4cf9f53a7dcd0c9) */
 /***********************************************************************************/
 
 #include <pybind11/complex.h>
@@ -40,6 +40,7 @@ void bind_m17_decoder(py::module &m) {
            py::arg("debug_ctrl"), py::arg("sw_threshold"),
            py::arg("vt_threshold"), py::arg("callsign"), py::arg("signed_str"),
            py::arg("encr_type"), py::arg("key"), py::arg("seed"),
+           py::arg("input_type") = 0, py::arg("sps") = 1,
            D(m17_decoder, make))
 
       .def("set_debug_data", &m17_decoder::set_debug_data, py::arg("debug"),
@@ -60,9 +61,56 @@ void bind_m17_decoder(py::module &m) {
       .def("set_signed", &m17_decoder::set_signed, py::arg("signed_str"),
            D(m17_decoder, set_signed))
 
+      .def("set_flywheel", &m17_decoder::set_flywheel, py::arg("max_misses"),
+           D(m17_decoder, set_flywheel))
+
+      .def("set_false_alarm_rate", &m17_decoder::set_false_alarm_rate,
+           py::arg("pfa"), D(m17_decoder, set_false_alarm_rate))
+
+      .def("sw_threshold", &m17_decoder::sw_threshold,
+           D(m17_decoder, sw_threshold))
+
+      .def("false_sync_rate", &m17_decoder::false_sync_rate,
+           D(m17_decoder, false_sync_rate))
+
+      .def("set_squelch", &m17_decoder::set_squelch, py::arg("hang_time"),
+           D(m17_decoder, set_squelch))
+
+      .def("squelch_open", &m17_decoder::squelch_open,
+           D(m17_decoder, squelch_open))
+
+      .def("set_normalize", &m17_decoder::set_normalize, py::arg("normalize"),
+           D(m17_decoder, set_normalize))
+
+      .def("set_soft_bits", &m17_decoder::set_soft_bits, py::arg("bits"),
+           D(m17_decoder, set_soft_bits))
+
+      .def("rejects_lich", &m17_decoder::rejects_lich,
+           D(m17_decoder, rejects_lich))
+
+      .def("rejects_viterbi", &m17_decoder::rejects_viterbi,
+           D(m17_decoder, rejects_viterbi))
+
+      .def("rejects_fn", &m17_decoder::rejects_fn, D(m17_decoder, rejects_fn))
+
       .def("set_key", &m17_decoder::set_key, py::arg("key"),
            D(m17_decoder, set_key))
 
+      .def("set_pub_keys", &m17_decoder::set_pub_keys, py::arg("keys"),
+           D(m17_decoder, set_pub_keys))
+
+      .def("set_keyring", &m17_decoder::set_keyring, py::arg("keys"),
+           D(m17_decoder, set_keyring))
+
+      .def("set_filter", &m17_decoder::set_filter, py::arg("rules"),
+           D(m17_decoder, set_filter))
+
+      .def("frames_filtered", &m17_decoder::frames_filtered,
+           D(m17_decoder, frames_filtered))
+
+      .def("set_output_mode", &m17_decoder::set_output_mode, py::arg("mode"),
+           D(m17_decoder, set_output_mode))
+
       .def("set_seed", &m17_decoder::set_seed, py::arg("seed"),
            D(m17_decoder, set_seed))
 